@@ -1,6 +1,97 @@
+#pragma once
 #include "torus.cpp"
 #include <stdlib.h>
-#include <time.h>
+#include <string>
+#include <type_traits>
+
+/*
+ * Runtime to compile time strategy dispatch. with_strategy_2D(strategy, f)
+ * calls f with a std::integral_constant holding the strategy, so that f
+ * can instantiate a step loop for it, e.g.
+ *
+ *     with_strategy_2D(agent->strategy, [&](auto s) { steps<decltype(s)::value>(); });
+ *
+ * Doing this once per sample instead of testing the strategy on every step
+ * lets the compiler inline the strategy into the loop.
+ */
+template <int strategy_id>
+using strategy_constant = std::integral_constant<int, strategy_id>;
+
+inline bool is_strategy_2D(int strategy) {
+    return strategy == VIKI || strategy == VIKI_COLORBLIND || strategy == RANDOM_WALK
+        || strategy == GREEDY_BIASED || strategy == GREEDY_UNBIASED || strategy == RANDOM_WALK_NB;
+}
+
+inline bool is_strategy_3D(int strategy) {
+    return strategy == VIKI || strategy == RANDOM_WALK || strategy == GREEDY_BIASED || strategy == GREEDY_UNBIASED
+        || strategy == GREEDY_BIASED_XY || strategy == GREEDY_BIASED_YZ || strategy == GREEDY_BIASED_ZX || strategy == RANDOM_WALK_NB
+        || strategy == GREEDY_BIASED_CYCLE;
+}
+
+// the name of a strategy, as its macro
+inline const char * strategy_name(int strategy) {
+    switch (strategy) {
+        case VIKI: return "VIKI";
+        case RANDOM_WALK: return "RANDOM_WALK";
+        case GREEDY_BIASED: return "GREEDY_BIASED";
+        case GREEDY_UNBIASED: return "GREEDY_UNBIASED";
+        case GREEDY_BIASED_XY: return "GREEDY_BIASED_XY";
+        case GREEDY_BIASED_YZ: return "GREEDY_BIASED_YZ";
+        case GREEDY_BIASED_ZX: return "GREEDY_BIASED_ZX";
+        case VIKI_COLORBLIND: return "VIKI_COLORBLIND";
+        case RANDOM_WALK_NB: return "RANDOM_WALK_NB";
+        case GREEDY_BIASED_CYCLE: return "GREEDY_BIASED_CYCLE";
+    }
+    return "none";
+}
+
+// the strategy a name of strategy_name() stands for, -1 for none
+inline int strategy_by_name(const std::string & name) {
+    for (int strategy = VIKI; strategy <= GREEDY_BIASED_CYCLE; strategy++) {
+        if (name == strategy_name(strategy)) return strategy;
+    }
+    return -1;
+}
+
+template <class F>
+void with_strategy_2D(int strategy, F f) {
+    switch (strategy) {
+        case VIKI: f(strategy_constant<VIKI>()); break;
+        case VIKI_COLORBLIND: f(strategy_constant<VIKI_COLORBLIND>()); break;
+        case RANDOM_WALK: f(strategy_constant<RANDOM_WALK>()); break;
+        case GREEDY_BIASED: f(strategy_constant<GREEDY_BIASED>()); break;
+        case GREEDY_UNBIASED: f(strategy_constant<GREEDY_UNBIASED>()); break;
+        case RANDOM_WALK_NB: f(strategy_constant<RANDOM_WALK_NB>()); break;
+    }
+}
+
+template <class F>
+void with_strategy_3D(int strategy, F f) {
+    switch (strategy) {
+        case VIKI: f(strategy_constant<VIKI>()); break;
+        case RANDOM_WALK: f(strategy_constant<RANDOM_WALK>()); break;
+        case GREEDY_BIASED: f(strategy_constant<GREEDY_BIASED>()); break;
+        case GREEDY_UNBIASED: f(strategy_constant<GREEDY_UNBIASED>()); break;
+        case GREEDY_BIASED_XY: f(strategy_constant<GREEDY_BIASED_XY>()); break;
+        case GREEDY_BIASED_YZ: f(strategy_constant<GREEDY_BIASED_YZ>()); break;
+        case GREEDY_BIASED_ZX: f(strategy_constant<GREEDY_BIASED_ZX>()); break;
+        case RANDOM_WALK_NB: f(strategy_constant<RANDOM_WALK_NB>()); break;
+        case GREEDY_BIASED_CYCLE: f(strategy_constant<GREEDY_BIASED_CYCLE>()); break;
+    }
+}
+
+// 1D agents only walk randomly
+template <class F>
+void with_strategy_1D(int, F f) {
+    f(strategy_constant<RANDOM_WALK>());
+}
+
+template <int dimension, class F>
+void with_strategy(int strategy, F f) {
+    if constexpr (dimension == 1) with_strategy_1D(strategy, f);
+    if constexpr (dimension == 2) with_strategy_2D(strategy, f);
+    if constexpr (dimension == 3) with_strategy_3D(strategy, f);
+}
 
 /*
  * Creates an agent in 1D with an ID, an initial position,
@@ -14,9 +105,10 @@ class agent_1D {
         unsigned int area_covered;
         torus_1D * t; 
         unsigned int starting_position; 
+        int strategy = RANDOM_WALK;
+        direction_buffer random_directions = direction_buffer(2);
 
         agent_1D(torus_1D * _t, uint8_t _id, unsigned int _starting_position) {
-            srand(time(NULL));
             this->x = _starting_position;
             this->t = _t;
             this->id = _id;
@@ -24,33 +116,59 @@ class agent_1D {
             this->starting_position = _starting_position;
         }
 
-        void reset_agent() {
+        // the same agent on another torus
+        agent_1D * copy(torus_1D * _t) {
+            return new agent_1D(_t, this->id, this->starting_position);
+        }
+
+        // where the agent is in a running sample, for a snapshot
+        void save(std::ostream & out) {
+            save_value(out, this->x);
+            save_value(out, this->area_covered);
+            this->random_directions.save(out);
+        }
+
+        void load(std::istream & in) {
+            load_value(in, this->x);
+            load_value(in, this->area_covered);
+            this->random_directions.load(in);
+        }
+
+        void reset_agent(rng_stream &) {
             this->x = this->starting_position;
             this->area_covered = 0;
+            this->random_directions.clear();
         }
 
         void update_torus() {
             if (this->t->grid[this->x] == 0) {
-                this->t->grid[this->x] = this->id;
+                this->t->claim(this->x, this->id);
                 this->area_covered++;
             }
         }
 
-        void move() {
-            int r = rand();
+        void move(rng_stream & rng) {
             int direction = RIGHT;
-            if (r % 2 == 0) {
+            if (this->random_directions.next(rng)) {
                 direction = LEFT;
             }
-            this->x = (this->x + dirx[direction] + TORUS_SIZE) % TORUS_SIZE;
+            this->x = this->t->wrap(this->x + dirx[direction]);
             update_torus();
         }
+
+        template <int strategy_id>
+        void move(rng_stream & rng) {
+            move(rng);
+        }
 };
 
 /*
- * Creates an agent in 2D with an ID, a random initial position,
+ * Creates an agent in 2D with an ID, a random position drawn on every reset,
  * a running total of area covered on an associated torus, 
  * a strategy, and some memory in case the strategy is viki. 
+ *
+ * Every random choice is drawn from the rng_stream passed in by the
+ * simulation, which keys it by the agent's id.
  */
 class agent_2D {
     public:
@@ -59,17 +177,24 @@ class agent_2D {
         unsigned long long area_covered = 0;
         int memory[VIKI_MEMORY];
         int strategy = RANDOM_WALK;
+        direction_buffer random_directions = direction_buffer(4);
         torus_2D * t; 
 
         agent_2D(torus_2D * _t, int _strategy, uint8_t _id) {
-            srand(time(NULL));
-            this->x = rand() % TORUS_SIZE;
-            this->y = rand() % TORUS_SIZE;
             this->t = _t;
+            if (_id > this->t->max_id()) {
+                std::cerr << "agent id " << (int) _id << " does not fit in a " << this->t->bits_per_site << " bit torus" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            if (!is_strategy_2D(_strategy)) {
+                std::cerr << "strategy " << _strategy << " is not a 2D strategy" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->x = 0;
+            this->y = 0;
             this->id = _id;
             this->area_covered = 0;
             this->strategy = _strategy; 
-            this->t->grid[this->x][this->y] = this->id;
             this->memory[0] = RIGHT;
             this->memory[1] = 2;  
             for (int i = 2; i < VIKI_MEMORY; i++) {
@@ -77,10 +202,33 @@ class agent_2D {
             }
         }
 
-        void reset_agent() {
-            this->x = rand() % TORUS_SIZE;
-            this->y = rand() % TORUS_SIZE;
+        // the same agent on another torus
+        agent_2D * copy(torus_2D * _t) {
+            return new agent_2D(_t, this->strategy, this->id);
+        }
+
+        // where the agent is in a running sample, for a snapshot
+        void save(std::ostream & out) {
+            save_value(out, this->x);
+            save_value(out, this->y);
+            save_value(out, this->area_covered);
+            save_value(out, this->memory);
+            this->random_directions.save(out);
+        }
+
+        void load(std::istream & in) {
+            load_value(in, this->x);
+            load_value(in, this->y);
+            load_value(in, this->area_covered);
+            load_value(in, this->memory);
+            this->random_directions.load(in);
+        }
+
+        void reset_agent(rng_stream & rng) {
+            this->x = rng.uniform(this->t->size);
+            this->y = rng.uniform(this->t->size);
             this->area_covered = 0;
+            this->random_directions.clear();
             this->memory[0] = RIGHT;
             this->memory[1] = 2;  
             for (int i = 2; i < VIKI_MEMORY; i++) {
@@ -92,6 +240,7 @@ class agent_2D {
             this->x = 0;
             this->y = 0;
             this->area_covered = 0;
+            this->random_directions.clear();
             this->memory[0] = RIGHT;
             this->memory[1] = 2;  
             for (int i = 2; i < VIKI_MEMORY; i++) {
@@ -103,6 +252,7 @@ class agent_2D {
             this->x = 1 + distance / 2;
             this->y = 0 + distance / 2;
             this->area_covered = 0;
+            this->random_directions.clear();
             this->memory[0] = RIGHT;
             this->memory[1] = 2;  
             for (int i = 2; i < VIKI_MEMORY; i++) {
@@ -111,35 +261,55 @@ class agent_2D {
         }
 
         void update_torus() {
-            if (this->t->grid[this->x][this->y] == 0) {
-                this->t->grid[this->x][this->y] = this->id;
+            update_torus(this->t->index(this->x, this->y));
+        }
+
+        // claims the site the agent is on, at position site in the grid, if it is blank
+        void update_torus(size_t site) {
+            if (this->t->get_site(site) == BLANK) {
+                this->t->claim_site(site, this->x, this->y, this->id);
                 this->area_covered++;
             }
         }
 
-        void move() {
+        // one step with the strategy fixed at compile time, so the strategy's direction function is inlined
+        template <int strategy_id>
+        void move(rng_stream & rng) {
             int direction = 0;
-            if (strategy == VIKI) direction = viki();
-            if (strategy == VIKI_COLORBLIND) direction = viki_colorblind();
-            if (strategy == RANDOM_WALK) direction = random_walk();
-            if (strategy == GREEDY_BIASED) direction = greedy_biased();
-            if (strategy == GREEDY_UNBIASED) direction = greedy_unbiased();
-            if (strategy == RANDOM_WALK_NB) direction = random_walk_non_backtracking();
-            if (peek(direction) == MINE) return;
-            this->x = (this->x + dirx[direction] + TORUS_SIZE) % TORUS_SIZE;
-            this->y = (this->y + diry[direction] + TORUS_SIZE) % TORUS_SIZE;
-            update_torus();
+            if constexpr (strategy_id == VIKI) direction = viki(rng);
+            if constexpr (strategy_id == VIKI_COLORBLIND) direction = viki_colorblind(rng);
+            if constexpr (strategy_id == RANDOM_WALK) direction = random_walk(rng);
+            if constexpr (strategy_id == GREEDY_BIASED) direction = greedy_biased(rng);
+            if constexpr (strategy_id == GREEDY_UNBIASED) direction = greedy_unbiased(rng);
+            if constexpr (strategy_id == RANDOM_WALK_NB) direction = random_walk_non_backtracking(rng);
+            size_t site = this->t->neighbour(this->x, this->y, direction);
+            if (this->t->get_site(site) == MINE) return;
+            this->x = this->t->wrap(this->x + dirx[direction]);
+            this->y = this->t->wrap(this->y + diry[direction]);
+            update_torus(site);
+        }
+
+        void move(rng_stream & rng) {
+            with_strategy_2D(this->strategy, [&](auto strategy) {
+                this->move<decltype(strategy)::value>(rng);
+            });
+        }
+
+        // the site next to the agent in direction dir, -1 for ZUP and ZDOWN
+        uint8_t peek(int dir) {
+            if (dir == ZUP || dir == ZDOWN) return -1;
+            return this->t->get_site(this->t->neighbour(this->x, this->y, dir));
         }
 
-        uint8_t peek(int dir) {
-            if (dir == RIGHT) return this->t->grid[(this->x + 1) % TORUS_SIZE][this->y];
-            if (dir == UP) return this->t->grid[this->x][(this->y + 1) % TORUS_SIZE];
-            if (dir == LEFT) return this->t->grid[(this->x - 1 + TORUS_SIZE) % TORUS_SIZE][this->y];
-            if (dir == DOWN) return this->t->grid[this->x][(this->y - 1 + TORUS_SIZE) % TORUS_SIZE];
-            return -1; 
+        // a uniform index in [0, count), taken from the direction buffer when count allows it
+        int random_index(int count, rng_stream & rng) {
+            if (count == 4) return this->random_directions.next(rng);
+            if (count == 2) return this->random_directions.next(rng) & 1;
+            if (count == 1) return 0;
+            return rng.uniform(count);
         }
 
-        int random_walk() {
+        int random_walk(rng_stream & rng) {
             int directions[4];
             int count = 0;
             if (peek(RIGHT) != MINE) directions[count++] = RIGHT;
@@ -147,10 +317,33 @@ class agent_2D {
             if (peek(LEFT) != MINE) directions[count++] = LEFT;
             if (peek(DOWN) != MINE) directions[count++] = DOWN;
             if (count == 0) return RIGHT;
-            return directions[rand() % count]; 
+            return directions[random_index(count, rng)]; 
+        }
+
+        /*
+         * The direction move<strategy_id>() takes on a torus without mines,
+         * for RANDOM_WALK and RANDOM_WALK_NB, which only look at the sites
+         * around them for mines. It draws from rng and updates the memory
+         * the same way.
+         */
+        template <int strategy_id>
+        int unmined_direction(rng_stream & rng) {
+            static_assert(strategy_id == RANDOM_WALK || strategy_id == RANDOM_WALK_NB, "the strategy looks at the sites");
+            if constexpr (strategy_id == RANDOM_WALK) {
+                static const int directions[4] = {RIGHT, UP, LEFT, DOWN};
+                return directions[random_index(4, rng)];
+            }
+            int directions[4];
+            int count = 0;
+            for (const int &direction : {RIGHT, LEFT, DOWN, UP}) {
+                if (direction != this->memory[0]) directions[count++] = direction;
+            }
+            int direction = directions[random_index(count, rng)];
+            this->memory[0] = this->opposite(direction);
+            return direction;
         }
 
-        int random_walk_non_backtracking() {
+        int random_walk_non_backtracking(rng_stream & rng) {
             int directions[4];
             int count = 0;
             int last_direction = this->memory[0];
@@ -166,14 +359,14 @@ class agent_2D {
             }
             int direction = RIGHT;
             if (count > 0) {
-                direction = directions[rand() % count];
+                direction = directions[random_index(count, rng)];
                 this->memory[0] = this->opposite(direction);
                 return direction;
             } else if (count == 0 && non_mine_count == 1) {
                 this->memory[0] = this->opposite(last_direction);
                 return last_direction;
             } else {
-                direction = this->random_walk();
+                direction = this->random_walk(rng);
                 this->memory[0] = this->opposite(direction);
                 return direction;
             }
@@ -189,15 +382,15 @@ class agent_2D {
             return RIGHT;
         }
 
-        int greedy_biased() {
+        int greedy_biased(rng_stream & rng) {
             if (peek(RIGHT) == BLANK) return RIGHT; 
             if (peek(UP) == BLANK) return UP; 
             if (peek(LEFT) == BLANK) return LEFT; 
             if (peek(DOWN) == BLANK) return DOWN; 
-            return random_walk(); 
+            return random_walk(rng); 
         }
 
-        int greedy_unbiased() {
+        int greedy_unbiased(rng_stream & rng) {
             int directions[4];
             int count = 0;
             for (int direction = 0; direction < 5; direction++) {
@@ -208,12 +401,12 @@ class agent_2D {
                     if (peek(direction - 1) == BLANK) directions[count++] = direction - 1; 
                 }
             }
-            if (count == 0) return random_walk();
-            return directions[rand() % count]; 
+            if (count == 0) return random_walk(rng);
+            return directions[random_index(count, rng)]; 
         }
 
-        int viki_colorblind() {
-            if (peek(RIGHT) != BLANK && peek(UP) != BLANK && peek(LEFT) != BLANK && peek(DOWN) != BLANK) return random_walk();
+        int viki_colorblind(rng_stream & rng) {
+            if (peek(RIGHT) != BLANK && peek(UP) != BLANK && peek(LEFT) != BLANK && peek(DOWN) != BLANK) return random_walk(rng);
             int last_direction = this->memory[0];
             if (last_direction == RIGHT) {
                 if (peek(UP) == BLANK) {
@@ -271,25 +464,25 @@ class agent_2D {
                     return LEFT; 
                 }
             }
-            return random_walk();
+            return random_walk(rng);
         }
 
         // VIKI HELPER METHODS
 
         int get_encoding(int x, int y) {
-            if (x < 0) x += TORUS_SIZE;
-            if (x >= TORUS_SIZE) x -= TORUS_SIZE;
-            if (y < 0) x += TORUS_SIZE;
-            if (y >= TORUS_SIZE) x -= TORUS_SIZE;            
-            return x * TORUS_SIZE + y;
+            if (x < 0) x += this->t->size;
+            if (x >= this->t->size) x -= this->t->size;
+            if (y < 0) x += this->t->size;
+            if (y >= this->t->size) x -= this->t->size;            
+            return x * this->t->size + y;
         }
 
         int get_x(int encoding) {
-            return encoding / TORUS_SIZE;
+            return encoding / this->t->size;
         }
 
         int get_y(int encoding) {
-            return encoding % TORUS_SIZE;
+            return encoding % this->t->size;
         }
 
         bool is_in_memory(int encoding) {
@@ -299,13 +492,13 @@ class agent_2D {
             return false;
         }
 
-        int viki() {
+        int viki(rng_stream & rng) {
             int last_direction = this->memory[0];
             bool right_open = !is_in_memory(get_encoding(this->x + 1, this->y)) && peek(RIGHT) != this->id && peek(RIGHT) != MINE;
             bool left_open = !is_in_memory(get_encoding(this->x - 1, this->y)) && peek(LEFT) != this->id && peek(LEFT) != MINE;
             bool up_open = !is_in_memory(get_encoding(this->x, this->y + 1)) && peek(UP) != this->id && peek(UP) != MINE;
             bool down_open = !is_in_memory(get_encoding(this->x, this->y - 1)) && peek(DOWN) != this->id && peek(DOWN) != MINE;
-            if (!right_open && !left_open && !up_open && !down_open) return random_walk();
+            if (!right_open && !left_open && !up_open && !down_open) return random_walk(rng);
             if (last_direction == RIGHT) {
                 if (up_open) return UP;
                 if (right_open) return RIGHT;
@@ -330,12 +523,12 @@ class agent_2D {
                 if (left_open) return LEFT;
                 return UP;
             }
-            return random_walk();
+            return random_walk(rng);
         }
 };
 
 /*
- * Creates an agent in 3D with an ID, a random initial position,
+ * Creates an agent in 3D with an ID, a random position drawn on every reset,
  * a running total of area covered on an associated torus, 
  * a strategy, and some memory in case the strategy is viki. 
  */
@@ -344,99 +537,126 @@ class agent_3D {
         int x, y, z;
         uint8_t id = 1;
         unsigned long long area_covered = 0;
-        int memory[MEMORY];
+        long long memory[MEMORY];
         int strategy = RANDOM_WALK;
+        long long cycle_step = 0;
+        direction_buffer random_directions = direction_buffer(6);
         torus_3D * t; 
 
         agent_3D(torus_3D * _t, int _strategy, uint8_t _id) {
-            srand(time(NULL));
-            this->x = rand() % TORUS_SIZE;
-            this->y = rand() % TORUS_SIZE;
-            this->z = rand() % TORUS_SIZE;
             this->t = _t;
+            if (!is_strategy_3D(_strategy)) {
+                std::cerr << "strategy " << _strategy << " is not a 3D strategy" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->x = 0;
+            this->y = 0;
+            this->z = 0;
             this->id = _id;
             this->area_covered = 0;
             this->strategy = _strategy; 
-            this->t->grid[this->x][this->y][this->z] = this->id;
             for (int i = 0; i < MEMORY; i++) {
                 this->memory[i] = 0;
             }
         }
 
-        void reset_agent() {
-            this->x = rand() % TORUS_SIZE;
-            this->y = rand() % TORUS_SIZE;
+        // the same agent on another torus
+        agent_3D * copy(torus_3D * _t) {
+            return new agent_3D(_t, this->strategy, this->id);
+        }
+
+        // where the agent is in a running sample, for a snapshot
+        void save(std::ostream & out) {
+            save_value(out, this->x);
+            save_value(out, this->y);
+            save_value(out, this->z);
+            save_value(out, this->area_covered);
+            save_value(out, this->memory);
+            save_value(out, this->cycle_step);
+            this->random_directions.save(out);
+        }
+
+        void load(std::istream & in) {
+            load_value(in, this->x);
+            load_value(in, this->y);
+            load_value(in, this->z);
+            load_value(in, this->area_covered);
+            load_value(in, this->memory);
+            load_value(in, this->cycle_step);
+            this->random_directions.load(in);
+        }
+
+        void reset_agent(rng_stream & rng) {
+            this->x = rng.uniform(this->t->size);
+            this->y = rng.uniform(this->t->size);
+            this->z = rng.uniform(this->t->size);
             this->area_covered = 0;
+            this->cycle_step = 0;
+            this->random_directions.clear();
             for (int i = 0; i < MEMORY; i++) {
                 this->memory[i] = 0;
             }
         }
 
         void update_torus() {
-            if (this->t->grid[this->x][this->y][this->z] == BLANK) {
-                this->t->grid[this->x][this->y][this->z] = this->id;
+            update_torus(this->t->site_key(this->x, this->y, this->z));
+        }
+
+        // claims the site the agent is on, with key site, if it is blank
+        void update_torus(uint64_t site) {
+            if (this->t->get_site(site) == BLANK) {
+                this->t->set_site(site, this->id);
                 this->area_covered++;
             }
         }
 
-        void move(int iteration) {
-            int direction = 0;
-            if (iteration % 300 < 100) this->strategy = GREEDY_BIASED_XY;
-            else if (iteration % 300 < 200) this->strategy = GREEDY_BIASED_YZ;
-            else if (iteration % 300 < 300) this->strategy = GREEDY_BIASED_ZX;
-            if (this->strategy == GREEDY_BIASED_XY) direction = greedy_biased_xy();
-            if (this->strategy == GREEDY_BIASED_YZ) direction = greedy_biased_yz();
-            if (this->strategy == GREEDY_BIASED_ZX) direction = greedy_biased_zx();
-            int new_x = (this->x + dirx[direction] + TORUS_SIZE) % TORUS_SIZE;
-            int new_y = (this->y + diry[direction] + TORUS_SIZE) % TORUS_SIZE;
-            int new_z = (this->z + dirz[direction] + TORUS_SIZE) % TORUS_SIZE;
-            if (this->t->grid[new_x][new_y][new_z] == MINE) {
-                return;
-            }
-            this->x = new_x;
-            this->y = new_y;
-            this->z = new_z; 
-            update_torus();
+        void move(rng_stream & rng) {
+            with_strategy_3D(this->strategy, [&](auto strategy) {
+                this->move<decltype(strategy)::value>(rng);
+            });
         }
 
-        void move() {
+        // one step with the strategy fixed at compile time, so the strategy's direction function is inlined
+        template <int strategy_id>
+        void move(rng_stream & rng) {
             int direction = 0;
-            if (strategy == VIKI) direction = viki();
-            if (strategy == RANDOM_WALK) direction = random_walk();
-            if (strategy == GREEDY_BIASED) direction = greedy_biased();
-            if (strategy == GREEDY_UNBIASED) direction = greedy_unbiased();
-            if (strategy == GREEDY_BIASED_XY) direction = greedy_biased_xy();
-            if (strategy == GREEDY_BIASED_YZ) direction = greedy_biased_yz();
-            if (strategy == GREEDY_BIASED_ZX) direction = greedy_biased_zx();
-            if (strategy == RANDOM_WALK_NB) direction = random_walk_non_backtracking();
-            int new_x = (this->x + dirx[direction] + TORUS_SIZE) % TORUS_SIZE;
-            int new_y = (this->y + diry[direction] + TORUS_SIZE) % TORUS_SIZE;
-            int new_z = (this->z + dirz[direction] + TORUS_SIZE) % TORUS_SIZE;
-            if (this->t->grid[new_x][new_y][new_z] == MINE) {
+            if constexpr (strategy_id == VIKI) direction = viki();
+            if constexpr (strategy_id == RANDOM_WALK) direction = random_walk(rng);
+            if constexpr (strategy_id == GREEDY_BIASED) direction = greedy_biased(rng);
+            if constexpr (strategy_id == GREEDY_UNBIASED) direction = greedy_unbiased(rng);
+            if constexpr (strategy_id == GREEDY_BIASED_XY) direction = greedy_biased_xy(rng);
+            if constexpr (strategy_id == GREEDY_BIASED_YZ) direction = greedy_biased_yz(rng);
+            if constexpr (strategy_id == GREEDY_BIASED_ZX) direction = greedy_biased_zx(rng);
+            if constexpr (strategy_id == RANDOM_WALK_NB) direction = random_walk_non_backtracking(rng);
+            if constexpr (strategy_id == GREEDY_BIASED_CYCLE) direction = greedy_biased_cycle(rng);
+            uint64_t site = this->t->neighbour(this->x, this->y, this->z, direction);
+            if (this->t->get_site(site) == MINE) {
                 return;
             }
-            this->x = new_x;
-            this->y = new_y;
-            this->z = new_z; 
-            update_torus();
+            this->x = this->t->wrap(this->x + dirx[direction]);
+            this->y = this->t->wrap(this->y + diry[direction]);
+            this->z = this->t->wrap(this->z + dirz[direction]);
+            update_torus(site);
         }
 
+        // the site next to the agent in direction dir
         uint8_t peek(int dir) {
-            if (dir == RIGHT) return this->t->grid[(this->x + 1) % TORUS_SIZE][this->y][this->z];
-            if (dir == UP) return this->t->grid[this->x][(this->y + 1) % TORUS_SIZE][this->z];
-            if (dir == ZUP) return this->t->grid[this->x][this->y][(this->z + 1) % TORUS_SIZE];
-            if (dir == LEFT) return this->t->grid[(this->x - 1 + TORUS_SIZE) % TORUS_SIZE][this->y][this->z];
-            if (dir == DOWN) return this->t->grid[this->x][(this->y - 1 + TORUS_SIZE) % TORUS_SIZE][this->z];
-            if (dir == ZDOWN) return this->t->grid[this->x][this->y][(this->z - 1 + TORUS_SIZE) % TORUS_SIZE];
-            return -1; 
+            return this->t->get_site(this->t->neighbour(this->x, this->y, this->z, dir));
+        }
+
+        // a uniform index in [0, count), taken from the direction buffer when count allows it
+        int random_index(int count, rng_stream & rng) {
+            if (count == 6) return this->random_directions.next(rng);
+            if (count == 3 || count == 2) return this->random_directions.next(rng) % count;
+            if (count == 1) return 0;
+            return rng.uniform(count);
         }
 
-        int random_walk() {
-            int dir = rand() % 6;
-            return dir;  
+        int random_walk(rng_stream & rng) {
+            return this->random_directions.next(rng);
         }
 
-        int random_walk_non_backtracking() {
+        int random_walk_non_backtracking(rng_stream & rng) {
             int directions[6];
             int count = 0;
             int last_direction = this->memory[0];
@@ -448,43 +668,43 @@ class agent_3D {
             if (peek(ZDOWN) != MINE && peek(ZDOWN) != last_direction) directions[count++] = ZDOWN;
             int direction = RIGHT;
             if (count > 0) {
-                direction = directions[rand() % count];
+                direction = directions[random_index(count, rng)];
             }
             this->memory[0] = direction;
             return direction;
         }
 
-        int greedy_biased() {
+        int greedy_biased(rng_stream & rng) {
             if (peek(RIGHT) == BLANK) return RIGHT; 
             if (peek(UP) == BLANK) return UP; 
             if (peek(ZUP) == BLANK) return ZUP; 
             if (peek(LEFT) == BLANK) return LEFT; 
             if (peek(DOWN) == BLANK) return DOWN; 
             if (peek(ZDOWN) == BLANK) return ZDOWN; 
-            return random_walk(); 
+            return random_walk(rng); 
         }
 
-        int greedy_biased_xy() {
+        int greedy_biased_xy(rng_stream & rng) {
             if (peek(RIGHT) == BLANK) return RIGHT;
             if (peek(UP) == BLANK) return UP;
             if (peek(LEFT) == BLANK) return LEFT;
             if (peek(DOWN) == BLANK) return DOWN; 
             if (peek(ZUP) == BLANK) return ZUP;
             if (peek(ZDOWN) == BLANK) return ZDOWN;
-            return random_walk();
+            return random_walk(rng);
         }
 
-        int greedy_biased_yz() {
+        int greedy_biased_yz(rng_stream & rng) {
             if (peek(UP) == BLANK) return UP;
             if (peek(ZUP) == BLANK) return ZUP;
             if (peek(DOWN) == BLANK) return DOWN; 
             if (peek(ZDOWN) == BLANK) return ZDOWN;
             if (peek(RIGHT) == BLANK) return RIGHT;
             if (peek(LEFT) == BLANK) return LEFT;  
-            return random_walk();
+            return random_walk(rng);
         }
 
-        int greedy_biased_zx() {
+        int greedy_biased_zx(rng_stream & rng) {
             
             if (peek(ZUP) == BLANK) return ZUP;
             if (peek(RIGHT) == BLANK) return RIGHT;
@@ -492,40 +712,48 @@ class agent_3D {
             if (peek(LEFT) == BLANK) return LEFT;
             if (peek(UP) == BLANK) return UP;
             if (peek(DOWN) == BLANK) return DOWN; 
-            return random_walk();
+            return random_walk(rng);
         }
 
-        int greedy_unbiased() {
+        int greedy_biased_cycle(rng_stream & rng) {
+            long long phase = this->cycle_step++ % 300;
+            if (phase < 100) return greedy_biased_xy(rng);
+            if (phase < 200) return greedy_biased_yz(rng);
+            return greedy_biased_zx(rng);
+        }
+
+        int greedy_unbiased(rng_stream & rng) {
             int directions[6];
             int count = 0;
             for (int direction = 0; direction < 6; direction++) {
                 if (peek(direction) == BLANK) directions[count++] = direction; 
             }
-            if (count == 0) return random_walk();
-            return directions[rand() % count]; 
+            if (count == 0) return random_walk(rng);
+            return directions[random_index(count, rng)]; 
         }
 
         // VIKI METHODS
 
-        int get_encoding(int x, int y, int z) {
-            return x * TORUS_SIZE * TORUS_SIZE + y * TORUS_SIZE + z;
+        // encodings are 64 bit since size^3 does not fit in an int
+        long long get_encoding(long long x, long long y, long long z) {
+            return x * this->t->size * this->t->size + y * this->t->size + z;
         }
 
-        int get_x(int encoding) {
-            return encoding / (TORUS_SIZE * TORUS_SIZE);
+        int get_x(long long encoding) {
+            return encoding / ((long long) this->t->size * this->t->size);
         }
 
-        int get_y(int encoding) {
-            encoding -= get_x(encoding) * TORUS_SIZE * TORUS_SIZE;
-            return encoding / TORUS_SIZE;
+        int get_y(long long encoding) {
+            encoding -= get_x(encoding) * (long long) this->t->size * this->t->size;
+            return encoding / this->t->size;
         }
 
-        int get_z(int encoding) {
-            encoding -= get_x(encoding) * TORUS_SIZE * TORUS_SIZE;
-            return encoding % TORUS_SIZE;
+        int get_z(long long encoding) {
+            encoding -= get_x(encoding) * (long long) this->t->size * this->t->size;
+            return encoding % this->t->size;
         }
 
-        void assign_viki_memory(int zero, int one, int two, int three, int four, int five, int six) {
+        void assign_viki_memory(long long zero, long long one, long long two, long long three, long long four, long long five, long long six) {
             if (zero != -1) this->memory[0] = zero;
             if (one != -1) this->memory[1] = one;
             if (two != -1) this->memory[2] = two;
@@ -535,13 +763,13 @@ class agent_3D {
             if (six != -1) this->memory[6] = six;
         }
 
-        int corner_case_helper(bool x_dist, bool y_dist, bool z_dist) {
+        long long corner_case_helper(bool x_dist, bool y_dist, bool z_dist) {
             int start_x = get_x(this->memory[2]);
             int start_y = get_y(this->memory[2]);
             int start_z = get_z(this->memory[2]);
-            int x = x_dist ? ((start_x + this->memory[3]) % TORUS_SIZE) : ((start_x + this->memory[5]) % TORUS_SIZE);
-            int y = y_dist ? ((start_y + this->memory[3]) % TORUS_SIZE) : ((start_y + this->memory[5]) % TORUS_SIZE);
-            int z = z_dist ? ((start_z + this->memory[3]) % TORUS_SIZE) : ((start_z + this->memory[5]) % TORUS_SIZE);
+            int x = x_dist ? ((start_x + this->memory[3]) % this->t->size) : ((start_x + this->memory[5]) % this->t->size);
+            int y = y_dist ? ((start_y + this->memory[3]) % this->t->size) : ((start_y + this->memory[5]) % this->t->size);
+            int z = z_dist ? ((start_z + this->memory[3]) % this->t->size) : ((start_z + this->memory[5]) % this->t->size);
             return get_encoding(x, y, z);
         }
 
@@ -560,7 +788,7 @@ class agent_3D {
         }
 
         int viki() {
-            int cur = get_encoding(this->x, this->y, this->z);
+            long long cur = get_encoding(this->x, this->y, this->z);
             if (this->memory[0] == 0) {
                 assign_viki_memory(1, -1, cur, 1, -1, -1, -1);
                 return RIGHT; 
@@ -600,9 +828,9 @@ class agent_3D {
                     } else return RIGHT;
                 }
                 if (this->memory[4] == 5) {
-                    if (cur == get_encoding((start_x + this->memory[3]) % TORUS_SIZE, (start_y + this->memory[5] + 1) % TORUS_SIZE, (start_z + this->memory[5]) % TORUS_SIZE)) {
-                        if (cur == get_encoding((start_x + this->memory[3]) % TORUS_SIZE, (start_y + this->memory[3]) % TORUS_SIZE, (start_z + this->memory[3] - 1) % TORUS_SIZE)) {
-                            int new_start_encoding = get_encoding((start_x + this->memory[3] + 1) % TORUS_SIZE, (start_y + this->memory[3] + 1) % TORUS_SIZE, (start_z + this->memory[3] + 1) % TORUS_SIZE);
+                    if (cur == get_encoding((start_x + this->memory[3]) % this->t->size, (start_y + this->memory[5] + 1) % this->t->size, (start_z + this->memory[5]) % this->t->size)) {
+                        if (cur == get_encoding((start_x + this->memory[3]) % this->t->size, (start_y + this->memory[3]) % this->t->size, (start_z + this->memory[3] - 1) % this->t->size)) {
+                            long long new_start_encoding = get_encoding((start_x + this->memory[3] + 1) % this->t->size, (start_y + this->memory[3] + 1) % this->t->size, (start_z + this->memory[3] + 1) % this->t->size);
                             assign_viki_memory(-1, 1, new_start_encoding, this->memory[3] + 1, 0, 2, 0);
                         } else {
                             assign_viki_memory(-1, -1, -1, -1, 0, this->memory[5] + 1, -1);
@@ -619,39 +847,39 @@ class agent_3D {
                 start_y = get_y(this->memory[2]);
                 start_z = get_z(this->memory[2]);
                 if (this->memory[4] == 0) {
-                    if (cur == get_encoding(start_x, (start_y - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, start_z)) {
+                    if (cur == get_encoding(start_x, (start_y - this->memory[5] + this->t->size) % this->t->size, start_z)) {
                         this->memory[4] = 1;
                         return LEFT;
                     } else return ZUP;
                 }
                 if (this->memory[4] == 1) {
-                    if (cur == get_encoding((start_x - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, (start_y - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, start_z)) {
+                    if (cur == get_encoding((start_x - this->memory[5] + this->t->size) % this->t->size, (start_y - this->memory[5] + this->t->size) % this->t->size, start_z)) {
                         this->memory[4] = 2;
                         return UP;
                     } else return LEFT;
                 }
                 if (this->memory[4] == 2) {
-                    if (cur == get_encoding((start_x - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, start_y, start_z)) {
+                    if (cur == get_encoding((start_x - this->memory[5] + this->t->size) % this->t->size, start_y, start_z)) {
                         this->memory[4] = 3;
                         return ZDOWN;
                     } else return UP;
                 }
                 if (this->memory[4] == 3) {
-                    if (cur == get_encoding((start_x - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, start_y, (start_z - this->memory[5] + TORUS_SIZE) % TORUS_SIZE)) {
+                    if (cur == get_encoding((start_x - this->memory[5] + this->t->size) % this->t->size, start_y, (start_z - this->memory[5] + this->t->size) % this->t->size)) {
                         this->memory[4] = 4;
                         return RIGHT;
                     } else return ZDOWN;
                 }
                 if (this->memory[4] == 4) {
-                    if (cur == get_encoding(start_x, start_y, (start_z - this->memory[5] + TORUS_SIZE) % TORUS_SIZE)) {
+                    if (cur == get_encoding(start_x, start_y, (start_z - this->memory[5] + this->t->size) % this->t->size)) {
                         this->memory[4] = 5;
                         if (this->memory[3] - this->memory[5] != 1) return DOWN;
                     } else return RIGHT;
                 }
                 if (this->memory[4] == 5) {
-                    if (cur == get_encoding(start_x, (start_y - this->memory[5] + TORUS_SIZE) % TORUS_SIZE, (start_z - this->memory[5] + TORUS_SIZE) % TORUS_SIZE)) {
+                    if (cur == get_encoding(start_x, (start_y - this->memory[5] + this->t->size) % this->t->size, (start_z - this->memory[5] + this->t->size) % this->t->size)) {
                         if (this->memory[5] == this->memory[3]) {
-                            int new_start_encoding = get_encoding((this->x - this->memory[3] + TORUS_SIZE) % TORUS_SIZE, this->y, this->z);
+                            long long new_start_encoding = get_encoding((this->x - this->memory[3] + this->t->size) % this->t->size, this->y, this->z);
                             assign_viki_memory(-1, 0, new_start_encoding, this->memory[3] + 1, 0, 0, 0);
                             return RIGHT;
                         } else {
@@ -0,0 +1,180 @@
+#pragma once
+#include "parameters.h"
+#include "agent.cpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The step loop of two agents in 1D, taking 32 steps at a time.
+ *
+ * An agent in 1D has landed on every site between the leftmost and the
+ * rightmost site it has landed on, its arc, and all of those sites are
+ * claimed. A move that stays inside the arc changes nothing but the
+ * position, so only the moves past an end of the arc need the torus. The
+ * direction bits of an agent are the words of its stream, bit j of a word
+ * for step j of its 32 steps and 1 for LEFT, as direction_buffer hands
+ * them out, and the coins that order the agents are the words of the order
+ * stream, in the same way. For every 32 steps walk_arcs looks up how far
+ * each agent's word takes it to either side; when neither agent leaves its
+ * arc the steps only move the agents, otherwise they are taken one at a
+ * time as simulation::steps() takes them. The samples are the same as
+ * those of steps().
+ */
+
+// where 8 or 32 steps take an agent: the net move and the furthest it gets to either side
+struct arc_span {
+    int net = 0;
+    int low = 0;
+    int high = 0;
+};
+
+// the arc_span of the 8 steps of every byte of direction bits
+inline const arc_span * arc_byte_spans() {
+    static const std::vector<arc_span> spans = []() {
+        std::vector<arc_span> spans(256);
+        for (int bits = 0; bits < 256; bits++) {
+            arc_span & span = spans[bits];
+            for (int j = 0; j < 8; j++) {
+                span.net += (bits >> j & 1) ? -1 : 1;
+                span.low = std::min(span.low, span.net);
+                span.high = std::max(span.high, span.net);
+            }
+        }
+        return spans;
+    }();
+    return spans.data();
+}
+
+inline arc_span arc_word_span(uint32_t bits) {
+    const arc_span * spans = arc_byte_spans();
+    arc_span span;
+    for (int i = 0; i < 4; i++) {
+        const arc_span & byte = spans[bits >> (8 * i) & 0xFF];
+        span.low = std::min(span.low, span.net + byte.low);
+        span.high = std::max(span.high, span.net + byte.high);
+        span.net += byte.net;
+    }
+    return span;
+}
+
+// the words of a stream, drawn DIRECTION_WORDS at a time
+struct stream_words {
+    rng_stream * rng;
+    uint32_t words[DIRECTION_WORDS];
+    int next_word = DIRECTION_WORDS;
+
+    stream_words(rng_stream & _rng) {
+        this->rng = &_rng;
+    }
+
+    uint32_t next() {
+        if (this->next_word == DIRECTION_WORDS) {
+            this->rng->fill(this->words, DIRECTION_WORDS);
+            this->next_word = 0;
+        }
+        return this->words[this->next_word++];
+    }
+};
+
+// an agent of walk_arcs, with its position and arc on the unwrapped line
+struct arc_walker {
+    agent_1D * agent;
+    stream_words bits;
+    long long x;
+    // low > high until the agent lands somewhere, it has not claimed its starting site
+    long long low;
+    long long high;
+
+    arc_walker(agent_1D * _agent, rng_stream & rng) : bits(rng) {
+        this->agent = _agent;
+        this->x = _agent->x;
+        this->low = this->x + 1;
+        this->high = this->x - 1;
+    }
+
+    // whether the 32 steps of bits leave the agent inside its arc, with the span of the steps
+    bool stays_inside(uint32_t bits, arc_span & span) {
+        if (this->x - 32 >= this->low && this->x + 32 <= this->high) {
+            // too far from the ends to reach them, only the net move is needed
+            span.net = 32 - 2 * __builtin_popcount(bits);
+            return true;
+        }
+        span = arc_word_span(bits);
+        return this->x + span.low >= this->low && this->x + span.high <= this->high;
+    }
+
+    void move(bool left) {
+        int direction = left ? LEFT : RIGHT;
+        this->x += dirx[direction];
+        this->agent->x = this->agent->t->wrap(this->agent->x + dirx[direction]);
+        if (this->x >= this->low && this->x <= this->high) return;
+        this->low = std::min(this->low, this->x);
+        this->high = std::max(this->high, this->x);
+        this->agent->update_torus();
+    }
+
+    // the moves of a span that stays inside the arc, the agent's site is left to place()
+    void skip(const arc_span & span) {
+        this->x += span.net;
+    }
+
+    // puts the agent on the site of x
+    void place() {
+        int n = this->agent->t->size;
+        this->agent->x = (int) ((this->x % n + n) % n);
+    }
+};
+
+/*
+ * Steps agent1 and agent2 until the last checkpoint or until they have
+ * claimed all sites, calling record() at every checkpoint as steps() does
+ * and at the remaining checkpoints after the last step.
+ */
+template <class Record>
+void walk_arcs(agent_1D * agent1, agent_1D * agent2, rng_stream & rng1, rng_stream & rng2, rng_stream & order, const std::vector<long long> & checkpoints, unsigned long long sites, Record record) {
+    arc_walker walkers[2] = {arc_walker(agent1, rng1), arc_walker(agent2, rng2)};
+    stream_words coin_words(order);
+    long long last_step = checkpoints.back();
+    size_t current_checkpoint = 0;
+    long long next_checkpoint = checkpoints[0];
+    for (long long step = 0; step < last_step; step += 32) {
+        if (agent1->area_covered + agent2->area_covered >= sites) break;
+        uint32_t coins = coin_words.next();
+        uint32_t bits[2] = {walkers[0].bits.next(), walkers[1].bits.next()};
+        if (step + 32 <= last_step) {
+            arc_span spans[2];
+            if (walkers[0].stays_inside(bits[0], spans[0]) && walkers[1].stays_inside(bits[1], spans[1])) {
+                walkers[0].skip(spans[0]);
+                walkers[1].skip(spans[1]);
+                // nothing is claimed in between, so the checkpoints among the steps see their end
+                while (current_checkpoint < checkpoints.size() && next_checkpoint <= step + 32) {
+                    record();
+                    current_checkpoint++;
+                    if (current_checkpoint < checkpoints.size()) next_checkpoint = checkpoints[current_checkpoint];
+                }
+                continue;
+            }
+        }
+        walkers[0].place();
+        walkers[1].place();
+        int steps = (int) std::min(32LL, last_step - step);
+        for (int j = 0; j < steps; j++) {
+            // the coin decides which agent moves first, as in steps()
+            int first = !(coins >> j & 1);
+            for (int k = 0; k < 2; k++) {
+                walkers[first ^ k].move(bits[first ^ k] >> j & 1);
+            }
+            if (step + j + 1 == next_checkpoint) {
+                record();
+                current_checkpoint++;
+                if (current_checkpoint < checkpoints.size()) next_checkpoint = checkpoints[current_checkpoint];
+            }
+        }
+    }
+    walkers[0].place();
+    walkers[1].place();
+    for (; current_checkpoint < checkpoints.size(); current_checkpoint++) {
+        record();
+    }
+}
@@ -0,0 +1,377 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "simulate.cpp"
+
+/*
+ * Throughput benchmarks for the tori and agents.
+ *
+ * Build with g++ -O2 benchmark.cpp -o benchmark and run as
+ *   ./benchmark [torus size] [steps]
+ *   ./benchmark suite [JSON file] [steps]   runs the suite (see run_suite)
+ */
+
+const char * layout_names[] = {"row major", "tiled", "morton"};
+
+/*
+ * Times steps moves of one agent with the given strategy on a 2D torus
+ * with the given layout and returns the moves per second.
+ */
+double benchmark_2d_moves(int torus_size, int layout, int strategy, long long steps) {
+    torus_2D * tor = new torus_2D(torus_size, GRID_BITS, layout);
+    agent_2D * agent = new agent_2D(tor, strategy, 1);
+    rng_stream rng(1, 0, agent->id);
+    agent->reset_agent(rng);
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < steps; i++) {
+        agent->move(rng);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    delete agent;
+    delete tor;
+    return steps / elapsed.count();
+}
+
+void benchmark_2d_layouts(int torus_size, long long steps) {
+    std::cout << "agent_2D::move on a " << torus_size << " x " << torus_size << " torus, " << steps << " steps" << std::endl;
+    for (const int &strategy : {RANDOM_WALK, VIKI}) {
+        for (int layout = LAYOUT_ROW_MAJOR; layout <= LAYOUT_MORTON; layout++) {
+            double rate = benchmark_2d_moves(torus_size, layout, strategy, steps);
+            std::cout << (strategy == VIKI ? "viki" : "random walk") << ", " << layout_names[layout] << ": " 
+                      << rate << " steps/s, " << 1e9 / rate << " ns/step" << std::endl;
+        }
+    }
+}
+
+/*
+ * Times steps moves of one agent, choosing its strategy on every step with
+ * move(rng) when strategy_id is -1 and fixing it at compile time otherwise,
+ * and returns the moves per second.
+ */
+template <int strategy_id>
+double benchmark_2d_dispatch_moves(int torus_size, int strategy, long long steps) {
+    torus_2D * tor = new torus_2D(torus_size);
+    agent_2D * agent = new agent_2D(tor, strategy, 1);
+    rng_stream rng(1, 0, agent->id);
+    agent->reset_agent(rng);
+    auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < steps; i++) {
+        if constexpr (strategy_id < 0) agent->move(rng);
+        else agent->move<strategy_id>(rng);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    delete agent;
+    delete tor;
+    return steps / elapsed.count();
+}
+
+void benchmark_2d_dispatch(int torus_size, long long steps) {
+    std::cout << "runtime vs compile time strategy on a " << torus_size << " x " << torus_size << " torus, " << steps << " steps" << std::endl;
+    for (const int &strategy : {RANDOM_WALK, GREEDY_UNBIASED, VIKI}) {
+        double runtime = benchmark_2d_dispatch_moves<-1>(torus_size, strategy, steps);
+        double compile_time = 0;
+        with_strategy_2D(strategy, [&](auto s) {
+            compile_time = benchmark_2d_dispatch_moves<decltype(s)::value>(torus_size, strategy, steps);
+        });
+        std::cout << "strategy " << strategy << ": " << 1e9 / runtime << " ns/step with move(rng), "
+                  << 1e9 / compile_time << " ns/step with move<strategy>(rng)" << std::endl;
+    }
+}
+
+/*
+ * Times the census of a 2D torus with the given layout whose sites are
+ * blank, claimed by agent 1 or 2 or mined at random, with the scalar
+ * kernel, the SIMD kernels and the SIMD kernels on threads threads, and
+ * checks the interface against the one the torus kept while claiming.
+ */
+void benchmark_census(int torus_size, int layout, int threads) {
+    torus_2D * tor = new torus_2D(torus_size, GRID_BITS, layout);
+    tor->track_interface = true;
+    rng_stream rng(1, 0, 1);
+    for (int x = 0; x < torus_size; x++) {
+        for (int y = 0; y < torus_size; y++) {
+            int value = rng.uniform(4);
+            if (value == 1 || value == 2) tor->claim(x, y, value);
+            if (value == 3) tor->set(x, y, MINE);
+        }
+    }
+    std::cout << "census of a " << torus_size << " x " << torus_size << " torus, " << layout_names[layout] << ":";
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        torus_census result = census(*tor, run == 2 ? threads : 1, run == 0);
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        const char * names[] = {"scalar", "simd", "simd threads"};
+        std::cout << " " << names[run] << " " << elapsed.count() * 1000 << " ms";
+        if (result.interface() != tor->interface) std::cout << " (interface " << result.interface() << " instead of " << tor->interface << ")";
+    }
+    std::cout << std::endl;
+    delete tor;
+}
+
+/*
+ * Times samples samples of two agents on a 1D torus, stepping every move
+ * on the torus and with walk_arcs, and checks that both cover the same area.
+ */
+void benchmark_1d(int torus_size, int samples) {
+    std::cout << "1D_1v1 on a torus of " << torus_size << " sites, " << samples << " samples:";
+    std::vector<unsigned long long> totals[2];
+    for (int run = 0; run < 2; run++) {
+        torus_1D * tor = new torus_1D(torus_size);
+        agent_1D * agent1 = new agent_1D(tor, 1, 0);
+        agent_1D * agent2 = new agent_1D(tor, 2, torus_size / 2);
+        simulation_1D_1v1 sim(agent1, agent2, samples, NULL, NULL, 1);
+        sim.use_arcs = run == 1;
+        auto start = std::chrono::steady_clock::now();
+        sim.simulate_sample_size();
+        auto end = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::cout << (run == 0 ? " torus " : " arcs ") << elapsed.count() / samples * 1000 << " ms/sample";
+        totals[run] = sim.area_totals;
+        delete agent1;
+        delete agent2;
+        delete tor;
+    }
+    if (totals[0] != totals[1]) std::cout << " (the areas differ)";
+    std::cout << std::endl;
+}
+
+/*
+ * One measurement of the suite: operations of what name says, by an agent
+ * with strategy (-1 for none) on a torus of the dimension and size with
+ * occupancy of its sites claimed beforehand, took seconds.
+ */
+struct benchmark_entry {
+    std::string name;
+    int dimension;
+    int torus_size;
+    int strategy;
+    double occupancy;
+    long long operations;
+    double seconds;
+};
+
+// claims every site with chance occupancy, for agent 1, or for agent 1 or 2 with two_teams
+void occupy(torus_1D * t, double occupancy, rng_stream & rng, bool two_teams = false) {
+    for (int x = 0; x < t->size; x++) {
+        if (rng.next_double() < occupancy) t->claim(x, two_teams ? 1 + rng.uniform(2) : 1);
+    }
+}
+
+void occupy(torus_2D * t, double occupancy, rng_stream & rng, bool two_teams = false) {
+    for (int x = 0; x < t->size; x++) {
+        for (int y = 0; y < t->size; y++) {
+            if (rng.next_double() < occupancy) t->claim(x, y, two_teams ? 1 + rng.uniform(2) : 1);
+        }
+    }
+}
+
+void occupy(torus_3D * t, double occupancy, rng_stream & rng, bool two_teams = false) {
+    for (int x = 0; x < t->size; x++) {
+        for (int y = 0; y < t->size; y++) {
+            for (int z = 0; z < t->size; z++) {
+                if (rng.next_double() < occupancy) t->set(x, y, z, two_teams ? 1 + rng.uniform(2) : 1);
+            }
+        }
+    }
+}
+
+// 1D agents only walk randomly, so the suite records their entries as RANDOM_WALK
+agent_1D * new_agent(torus_1D * t, int) {
+    return new agent_1D(t, 1, 0);
+}
+
+agent_2D * new_agent(torus_2D * t, int strategy) {
+    return new agent_2D(t, strategy, 1);
+}
+
+agent_3D * new_agent(torus_3D * t, int strategy) {
+    return new agent_3D(t, strategy, 1);
+}
+
+// times steps moves of one agent with the strategy, fixed at compile time as the simulations fix it
+template <int dimension>
+benchmark_entry benchmark_moves(int torus_size, int strategy, double occupancy, long long steps) {
+    typedef typename lattice<dimension>::torus torus_type;
+    typedef typename lattice<dimension>::agent agent_type;
+    torus_type * tor = new torus_type(torus_size);
+    rng_stream rng(1, 0, 1);
+    occupy(tor, occupancy, rng);
+    agent_type * agent = new_agent(tor, strategy);
+    agent->reset_agent(rng);
+    auto start = std::chrono::steady_clock::now();
+    with_strategy<dimension>(strategy, [&](auto s) {
+        for (long long i = 0; i < steps; i++) {
+            agent->template move<decltype(s)::value>(rng);
+        }
+    });
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    delete agent;
+    delete tor;
+    return {"move", dimension, torus_size, dimension == 1 ? RANDOM_WALK : strategy, occupancy, steps, elapsed.count()};
+}
+
+// times resetting a torus with half its sites claimed, repeats times
+template <int dimension>
+benchmark_entry benchmark_reset(int torus_size, int repeats) {
+    typedef typename lattice<dimension>::torus torus_type;
+    torus_type * tor = new torus_type(torus_size);
+    rng_stream rng(1, 0, 1);
+    double seconds = 0;
+    for (int i = 0; i < repeats; i++) {
+        occupy(tor, 0.5, rng);
+        auto start = std::chrono::steady_clock::now();
+        tor->reset_torus();
+        auto end = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(end - start).count();
+    }
+    delete tor;
+    return {"reset_torus", dimension, torus_size, -1, 0.5, repeats, seconds};
+}
+
+// times resetting a 2D torus with half its sites claimed and laying a tenth of its sites with mines, repeats times
+benchmark_entry benchmark_reset_with_mines(int torus_size, int repeats) {
+    torus_2D * tor = new torus_2D(torus_size);
+    rng_stream rng(1, 0, 1);
+    double seconds = 0;
+    for (int i = 0; i < repeats; i++) {
+        occupy(tor, 0.5, rng);
+        auto start = std::chrono::steady_clock::now();
+        tor->reset_torus_with_mines(0.1, rng);
+        auto end = std::chrono::steady_clock::now();
+        seconds += std::chrono::duration<double>(end - start).count();
+    }
+    delete tor;
+    return {"reset_torus_with_mines", 2, torus_size, -1, 0.5, repeats, seconds};
+}
+
+/*
+ * Times the interface of a 2D torus with occupancy of its sites claimed by
+ * agent 1 or 2, counted by census() with the scalar kernel or the SIMD
+ * kernels on one thread, repeats times, and checks it against the one the
+ * torus kept while claiming.
+ */
+benchmark_entry benchmark_interface(int torus_size, double occupancy, bool scalar, int repeats) {
+    torus_2D * tor = new torus_2D(torus_size);
+    tor->track_interface = true;
+    rng_stream rng(1, 0, 1);
+    occupy(tor, occupancy, rng, true);
+    long interface = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        interface += census(*tor, 1, scalar).interface();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    if (interface != tor->interface * repeats) std::cout << "census counted an interface of " << interface / repeats << " instead of " << tor->interface << std::endl;
+    delete tor;
+    return {scalar ? "census_scalar" : "census_simd", 2, torus_size, -1, occupancy, repeats, elapsed.count()};
+}
+
+/*
+ * Times recording samples samples of a solo 2D simulation, with the areas
+ * at all U_LIST_LEN checkpoints, to an output file in the format (deleted
+ * afterwards).
+ */
+benchmark_entry benchmark_output(const std::string & file, int format, int samples) {
+    torus_2D * tor = new torus_2D(11);
+    agent_2D * agent = new agent_2D(tor, RANDOM_WALK, 1);
+    std::string sums = file + ".sums";
+    simulation_2D * sim = new simulation_2D(agent, samples, file.c_str(), sums.c_str(), 1);
+    sim->output_format = format;
+    sample_result result;
+    result.areas.resize(sim->checkpoints.size());
+    rng_stream rng(1, 0, 1);
+    sim->start_output();
+    auto start = std::chrono::steady_clock::now();
+    for (int sample = 0; sample < samples; sample++) {
+        for (size_t i = 0; i < result.areas.size(); i++) {
+            result.areas[i] = rng.uniform(1 << 20);
+        }
+        sim->record(sample, result);
+    }
+    sim->output_file.flush();
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    sim->finish_output();
+    delete sim;
+    delete agent;
+    delete tor;
+    std::remove(file.c_str());
+    std::remove(sums.c_str());
+    return {format == BINARY_OUTPUT ? "record_binary" : "record_text", 2, 11, -1, 0, samples, elapsed.count()};
+}
+
+void write_json(std::ostream & out, const std::vector<benchmark_entry> & entries, long long steps) {
+    out << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"steps\": " << steps << ",\n  \"results\": [";
+    for (size_t i = 0; i < entries.size(); i++) {
+        const benchmark_entry & e = entries[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << e.name << "\", \"dimension\": " << e.dimension
+            << ", \"torus_size\": " << e.torus_size << ", \"strategy\": \"" << strategy_name(e.strategy)
+            << "\", \"occupancy\": " << e.occupancy << ", \"operations\": " << e.operations
+            << ", \"seconds\": " << e.seconds << ", \"per_second\": " << e.operations / e.seconds
+            << ", \"ns_per_operation\": " << 1e9 * e.seconds / e.operations << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/*
+ * The benchmark suite: the moves of every strategy in 1D, 2D and 3D on tori
+ * of three sizes with none, half and nine tenths of their sites claimed,
+ * resetting the tori, the census of the interface and recording samples
+ * as text and binary. Prints one line per measurement and writes them all
+ * to json_file, to compare builds by.
+ */
+void run_suite(const std::string & json_file, long long steps) {
+    std::vector<benchmark_entry> entries;
+    const int sizes_1D[] = {1001, 100001, 10000001};
+    const int sizes_2D[] = {101, 1001, 4001};
+    const int sizes_3D[] = {15, 63, 255};
+    const double occupancies[] = {0, 0.5, 0.9};
+    for (int i = 0; i < 3; i++) {
+        for (double occupancy : occupancies) {
+            entries.push_back(benchmark_moves<1>(sizes_1D[i], RANDOM_WALK, occupancy, steps));
+            for (int strategy : {VIKI, VIKI_COLORBLIND, RANDOM_WALK, RANDOM_WALK_NB, GREEDY_BIASED, GREEDY_UNBIASED}) {
+                entries.push_back(benchmark_moves<2>(sizes_2D[i], strategy, occupancy, steps));
+            }
+            for (int strategy : {VIKI, RANDOM_WALK, RANDOM_WALK_NB, GREEDY_BIASED, GREEDY_UNBIASED, GREEDY_BIASED_XY, GREEDY_BIASED_YZ, GREEDY_BIASED_ZX, GREEDY_BIASED_CYCLE}) {
+                entries.push_back(benchmark_moves<3>(sizes_3D[i], strategy, occupancy, steps));
+            }
+        }
+        entries.push_back(benchmark_reset<1>(sizes_1D[i], 5));
+        entries.push_back(benchmark_reset<2>(sizes_2D[i], 5));
+        entries.push_back(benchmark_reset<3>(sizes_3D[i], 5));
+        entries.push_back(benchmark_reset_with_mines(sizes_2D[i], 5));
+        entries.push_back(benchmark_interface(sizes_2D[i], 0.5, true, 5));
+        entries.push_back(benchmark_interface(sizes_2D[i], 0.5, false, 5));
+    }
+    entries.push_back(benchmark_output(json_file + ".output", TEXT_OUTPUT, 10000));
+    entries.push_back(benchmark_output(json_file + ".output", BINARY_OUTPUT, 10000));
+    for (const benchmark_entry & e : entries) {
+        std::cout << e.name << " " << e.dimension << "D n=" << e.torus_size;
+        if (e.strategy >= 0) std::cout << " " << strategy_name(e.strategy);
+        std::cout << " occupancy " << e.occupancy << ": " << e.operations / e.seconds << "/s, " << 1e9 * e.seconds / e.operations << " ns" << std::endl;
+    }
+    std::ofstream out(json_file);
+    write_json(out, entries, steps);
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1 && strcmp(argv[1], "suite") == 0) {
+        run_suite(argc > 2 ? argv[2] : "benchmark.json", argc > 3 ? atoll(argv[3]) : 2000000);
+        return 0;
+    }
+    int torus_size = argc > 1 ? atoi(argv[1]) : TORUS_SIZE;
+    long long steps = argc > 2 ? atoll(argv[2]) : 50000000;
+    benchmark_2d_layouts(torus_size, steps);
+    benchmark_2d_dispatch(torus_size, steps);
+    for (int layout = LAYOUT_ROW_MAJOR; layout <= LAYOUT_MORTON; layout++) {
+        benchmark_census(torus_size, layout, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    benchmark_1d(torus_size, 4);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#pragma once
+#include "parameters.h"
+#include "torus.cpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * A census of a 2D torus: how many sites hold each value below
+ * CENSUS_VALUES (BLANK and the agent ids), how many hold a mine, and how
+ * many neighbouring sites are claimed by agent 1 and agent 2, counted
+ * separately for the neighbours along x, (x, y) and (x + 1, y), and along
+ * y, (x, y) and (x, y + 1).
+ */
+struct torus_census {
+    unsigned long long sites[CENSUS_VALUES] = {};
+    unsigned long long mines = 0;
+    // sites holding a value of CENSUS_VALUES or more other than MINE
+    unsigned long long other = 0;
+    unsigned long long interface_x = 0;
+    unsigned long long interface_y = 0;
+
+    // the interface between agent 1 and agent 2, as torus_2D::interface counts it
+    long interface() {
+        return this->interface_x + this->interface_y;
+    }
+
+    void add(const torus_census & other) {
+        for (int v = 0; v < CENSUS_VALUES; v++) {
+            this->sites[v] += other.sites[v];
+        }
+        this->mines += other.mines;
+        this->other += other.other;
+        this->interface_x += other.interface_x;
+        this->interface_y += other.interface_y;
+    }
+};
+
+inline bool is_interface(uint8_t a, uint8_t b) {
+    return std::min(a, b) == 1 && std::max(a, b) == 2;
+}
+
+/*
+ * Adds sites first .. n - 1 of a row of n sites to the census, with below
+ * the row after it. The right neighbour of the last site is the first.
+ */
+inline void census_row_scalar(const uint8_t * row, const uint8_t * below, int n, int first, torus_census & census) {
+    for (int y = first; y < n; y++) {
+        uint8_t value = row[y];
+        if (value < CENSUS_VALUES) census.sites[value]++;
+        else if (value == MINE) census.mines++;
+        else census.other++;
+        census.interface_x += is_interface(value, below[y]);
+        census.interface_y += is_interface(value, y + 1 < n ? row[y + 1] : row[0]);
+    }
+}
+
+#if defined(__x86_64__)
+/*
+ * The kernels below compare 16 or 32 sites at a time with every counted
+ * value and with their neighbours, and count the matching lanes with
+ * movemask and popcount. The last sites of a row, whose right neighbour
+ * wraps around, are left to census_row_scalar.
+ */
+
+__attribute__((target("avx2,popcnt")))
+inline void census_row_avx2(const uint8_t * row, const uint8_t * below, int n, torus_census & census) {
+    unsigned long long sites[CENSUS_VALUES] = {};
+    unsigned long long mines = 0, interface_x = 0, interface_y = 0;
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i mine = _mm256_set1_epi8((char) MINE);
+    int y = 0;
+    for (; y + 33 <= n; y += 32) {
+        __m256i value = _mm256_loadu_si256((const __m256i *) (row + y));
+        __m256i right = _mm256_loadu_si256((const __m256i *) (row + y + 1));
+        __m256i down = _mm256_loadu_si256((const __m256i *) (below + y));
+        for (int v = 0; v < CENSUS_VALUES; v++) {
+            sites[v] += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, _mm256_set1_epi8(v))));
+        }
+        mines += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_cmpeq_epi8(value, mine)));
+        __m256i low = _mm256_min_epu8(value, down), high = _mm256_max_epu8(value, down);
+        interface_x += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(low, one), _mm256_cmpeq_epi8(high, two))));
+        low = _mm256_min_epu8(value, right);
+        high = _mm256_max_epu8(value, right);
+        interface_y += _mm_popcnt_u32(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(low, one), _mm256_cmpeq_epi8(high, two))));
+    }
+    unsigned long long counted = y;
+    for (int v = 0; v < CENSUS_VALUES; v++) {
+        census.sites[v] += sites[v];
+        counted -= sites[v];
+    }
+    census.mines += mines;
+    census.other += counted - mines;
+    census.interface_x += interface_x;
+    census.interface_y += interface_y;
+    census_row_scalar(row, below, n, y, census);
+}
+
+// the same with SSE2, which every x86-64 cpu has
+inline void census_row_sse2(const uint8_t * row, const uint8_t * below, int n, torus_census & census) {
+    unsigned long long sites[CENSUS_VALUES] = {};
+    unsigned long long mines = 0, interface_x = 0, interface_y = 0;
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i mine = _mm_set1_epi8((char) MINE);
+    int y = 0;
+    for (; y + 17 <= n; y += 16) {
+        __m128i value = _mm_loadu_si128((const __m128i *) (row + y));
+        __m128i right = _mm_loadu_si128((const __m128i *) (row + y + 1));
+        __m128i down = _mm_loadu_si128((const __m128i *) (below + y));
+        for (int v = 0; v < CENSUS_VALUES; v++) {
+            sites[v] += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_set1_epi8(v))));
+        }
+        mines += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(value, mine)));
+        __m128i low = _mm_min_epu8(value, down), high = _mm_max_epu8(value, down);
+        interface_x += __builtin_popcount(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(low, one), _mm_cmpeq_epi8(high, two))));
+        low = _mm_min_epu8(value, right);
+        high = _mm_max_epu8(value, right);
+        interface_y += __builtin_popcount(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(low, one), _mm_cmpeq_epi8(high, two))));
+    }
+    unsigned long long counted = y;
+    for (int v = 0; v < CENSUS_VALUES; v++) {
+        census.sites[v] += sites[v];
+        counted -= sites[v];
+    }
+    census.mines += mines;
+    census.other += counted - mines;
+    census.interface_x += interface_x;
+    census.interface_y += interface_y;
+    census_row_scalar(row, below, n, y, census);
+}
+#endif
+
+// census_row_scalar over a whole row, with the widest kernel the cpu has unless scalar is set
+inline void census_row(const uint8_t * row, const uint8_t * below, int n, torus_census & census, bool scalar = false) {
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    if (!scalar && has_avx2) {
+        census_row_avx2(row, below, n, census);
+        return;
+    }
+    if (!scalar) {
+        census_row_sse2(row, below, n, census);
+        return;
+    }
+#endif
+    census_row_scalar(row, below, n, 0, census);
+}
+
+/*
+ * Adds rows first .. last - 1 of the torus to the census. A row major
+ * grid with 8 bits per site is read in place, other grids are copied or
+ * decoded a row at a time.
+ */
+inline void census_rows(torus_2D & t, int first, int last, torus_census & census, bool scalar = false) {
+    int n = t.size;
+    if (t.layout == LAYOUT_ROW_MAJOR && t.bits_per_site == 8) {
+        for (int x = first; x < last; x++) {
+            census_row(t.grid + (size_t) x * n, t.grid + (size_t) t.wrap(x + 1) * n, n, census, scalar);
+        }
+        return;
+    }
+    std::vector<uint8_t> row(n), below(n);
+    auto decode = [&](int x, std::vector<uint8_t> & out) {
+        if (t.layout == LAYOUT_TILED && t.bits_per_site == 8) {
+            // a row of a tile is stored in one piece
+            for (int y = 0; y < n; y += TILE_SIDE) {
+                memcpy(&out[y], t.grid + t.index(x, y), std::min(TILE_SIDE, n - y));
+            }
+            return;
+        }
+        for (int y = 0; y < n; y++) {
+            out[y] = t.get(x, y);
+        }
+    };
+    if (first < last) decode(first, below);
+    for (int x = first; x < last; x++) {
+        row.swap(below);
+        decode(t.wrap(x + 1), below);
+        census_row(row.data(), below.data(), n, census, scalar);
+    }
+}
+
+/*
+ * The census of a 2D torus, with its rows split into bands for up to
+ * threads threads. scalar skips the SIMD kernels, for comparing them.
+ */
+inline torus_census census(torus_2D & t, int threads = 1, bool scalar = false) {
+    int bands = std::max(1, std::min(threads, t.size));
+    std::vector<torus_census> partial(bands);
+    std::vector<std::thread> pool;
+    for (int i = 1; i < bands; i++) {
+        pool.push_back(std::thread([&, i]() {
+            census_rows(t, (long long) t.size * i / bands, (long long) t.size * (i + 1) / bands, partial[i], scalar);
+        }));
+    }
+    census_rows(t, 0, t.size / bands, partial[0], scalar);
+    for (std::thread & thread : pool) {
+        thread.join();
+    }
+    torus_census total;
+    for (torus_census & band : partial) {
+        total.add(band);
+    }
+    return total;
+}
@@ -0,0 +1,206 @@
+#pragma once
+#include "scheduler.cpp"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/*
+ * Experiment files: a batch of experiment_jobs to run in one process, so
+ * that changing a sample size, a strategy or a file name does not take a
+ * rebuild. Every "[experiment]" line starts an experiment, described by the
+ * "key = value" lines after it; # starts a comment. The lines before the
+ * first experiment set threads, memory (the scheduler's budget in MB) and
+ * experiment_id (the id of the first experiment, the others following it),
+ * and any experiment key there is the default of every experiment:
+ *
+ *     threads = 8
+ *     samples = 10000
+ *
+ *     [experiment]
+ *     dimension = 2
+ *     strategies = VIKI RANDOM_WALK
+ *     torus_size = 1001
+ *     mines = 0.05
+ *     checkpoints = log 100 1000 100000000
+ *     output = binary
+ *     file = viki_rw_1001.bin
+ *     file_sums = viki_rw_1001_sums.txt
+ *
+ * The experiment keys are dimension (1, 2 or 3), scenario (one of
+ * scenario_presets, which sets the dimension as well), strategies (names
+ * of strategy_name(), one for every agent of the scenario, ignored in 1D),
+ * torus_size, samples, second_position (of the second agent in 1D), mines
+ * (the mine chance of 2D_solo_mines and 2D_1v1_mines), distance (the odd
+ * starting distance of the agents of 2D_1v1_interface), checkpoints (a checkpoint_schedule: "[scaled] COUNT [MAX]",
+ * "linear COUNT LAST", "log COUNT FIRST LAST" or "list STEP..."), coverage
+ * (fractions of the sites in 2D, see simulation::set_coverage_fractions),
+ * output (text or binary), file, file_sums, visits_file, snapshot_file,
+ * and walk_lanes and jumps (true or false).
+ */
+struct experiment_batch {
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    // the memory budget of the scheduler in bytes, 0 for 90% of the available memory
+    unsigned long long memory = 0;
+    unsigned long long experiment_id = (unsigned long long) time(NULL) << 16;
+    std::vector<experiment_job> jobs;
+};
+
+// sets key of e to the value in fields, false if the key is unknown or the value does not fit it
+inline bool read_experiment_key(experiment_job & e, const std::string & key, std::istringstream & fields) {
+    std::string word;
+    if (key == "dimension") fields >> e.dimension;
+    else if (key == "torus_size") fields >> e.torus_size;
+    else if (key == "samples") fields >> e.sample_size;
+    else if (key == "second_position") fields >> e.second_position;
+    else if (key == "mines") fields >> e.mine_chance;
+    else if (key == "distance") fields >> e.distance;
+    else if (key == "file") fields >> e.file;
+    else if (key == "file_sums") fields >> e.file_sums;
+    else if (key == "visits_file") fields >> e.visits_file;
+    else if (key == "snapshot_file") fields >> e.snapshot_file;
+    else if (key == "checkpoints" && fields >> word) {
+        checkpoint_schedule & s = e.schedule;
+        s = checkpoint_schedule();
+        if (word == "scaled" || isdigit((unsigned char) word[0])) {
+            // "checkpoints = COUNT [MAX]" is scaled as well
+            if (word == "scaled") fields >> s.count;
+            else s.count = atoi(word.c_str());
+            double max;
+            if (fields >> max) s.max = max;
+            else if (!fields.eof()) return false;
+            else fields.clear();
+        } else if (word == "linear") {
+            s.kind = SCHEDULE_LINEAR;
+            fields >> s.count >> s.last;
+        } else if (word == "log") {
+            s.kind = SCHEDULE_LOG;
+            fields >> s.count >> s.first >> s.last;
+        } else if (word == "list") {
+            s.kind = SCHEDULE_LIST;
+            for (long long step; fields >> step;) {
+                s.steps.push_back(step);
+            }
+            fields.clear();
+        } else {
+            return false;
+        }
+    } else if (key == "coverage") {
+        e.coverage.clear();
+        for (double fraction; fields >> fraction;) {
+            if (fraction <= 0 || fraction > 1) return false;
+            e.coverage.push_back(fraction);
+        }
+        fields.clear();
+    } else if (key == "strategies") {
+        e.strategies.clear();
+        while (fields >> word) {
+            e.strategies.push_back(strategy_by_name(word));
+            if (e.strategies.back() < 0) return false;
+        }
+        if (e.strategies.empty()) return false;
+        fields.clear();
+    } else if (key == "scenario" && fields >> e.scenario) {
+        // an unknown scenario is left for check_experiment to report
+        const scenario_preset * preset = find_scenario(e.scenario);
+        if (preset != NULL) e.dimension = preset->dimension;
+    } else if (key == "output" && fields >> word) {
+        if (word != "text" && word != "binary") return false;
+        e.output_format = word == "binary" ? BINARY_OUTPUT : TEXT_OUTPUT;
+    } else if ((key == "walk_lanes" || key == "jumps") && fields >> word) {
+        if (word != "true" && word != "false") return false;
+        (key == "jumps" ? e.jumps : e.walk_lanes) = word == "true";
+    } else {
+        return false;
+    }
+    return !fields.fail() && !(fields >> word);
+}
+
+// whether schedule has checkpoints, all of them steps above 0 in increasing order
+inline bool valid_schedule(const checkpoint_schedule & s) {
+    if (s.kind == SCHEDULE_LIST) {
+        for (size_t i = 0; i < s.steps.size(); i++) {
+            if (s.steps[i] < 1 || (i > 0 && s.steps[i] <= s.steps[i - 1])) return false;
+        }
+        return !s.steps.empty();
+    }
+    if (s.count < 1) return false;
+    if (s.kind == SCHEDULE_SCALED) return s.max > 0;
+    if (s.kind == SCHEDULE_LINEAR) return s.last >= 1;
+    return s.first >= 1 && s.last >= s.first;
+}
+
+// whether the scheduler can run e, with a message on std::cerr if not
+inline bool check_experiment(const experiment_job & e, int number) {
+    std::string name = scenario_name(e);
+    const scenario_preset * preset = find_scenario(name);
+    std::string problem;
+    bool strategies_fit = true;
+    for (int strategy : e.strategies) {
+        if (e.dimension == 2 && !is_strategy_2D(strategy)) strategies_fit = false;
+        if (e.dimension == 3 && !is_strategy_3D(strategy)) strategies_fit = false;
+    }
+    if (e.dimension < 1 || e.dimension > 3) problem = "the dimension is not 1, 2 or 3";
+    else if (preset == NULL) problem = "there is no scenario " + name;
+    else if (preset->dimension != e.dimension) problem = "the scenario " + name + " is not a " + std::to_string(e.dimension) + "D scenario";
+    else if (preset->agents > 0 && (int) e.strategies.size() != preset->agents) problem = "the scenario " + name + " takes " + std::to_string(preset->agents) + " strategies";
+    else if (!strategies_fit) problem = "a strategy is not a " + std::to_string(e.dimension) + "D strategy";
+    else if (e.mine_chance > 0 && !preset->mines) problem = "the scenario " + name + " has no mines";
+    else if (e.distance != -1 && !preset->distance) problem = "the scenario " + name + " takes no distance";
+    else if (e.distance != -1 && (e.distance < 1 || e.distance % 2 == 0 || e.distance / 2 + 1 >= e.torus_size)) problem = "the distance is not an odd number of sites that fits on the torus";
+    else if (e.torus_size < 2 || e.sample_size < 1) problem = "the torus size or sample size is too small";
+    else if (!valid_schedule(e.schedule)) problem = "the checkpoints are not increasing steps above 0";
+    else if (!e.coverage.empty() && e.dimension != 2) problem = "coverage fractions are only recorded in 2D";
+    else if (e.dimension == 2 && (!e.coverage.empty() || !e.visits_file.empty()) && checkpoint_steps(e.schedule, 2, e.torus_size).back() > VISIT_STEP_MAX) problem = "visits and coverage fractions are only tracked up to step " + std::to_string(VISIT_STEP_MAX);
+    if (problem.empty()) return true;
+    std::cerr << "experiment " << number << ": " << problem << std::endl;
+    return false;
+}
+
+// reads an experiment file into batch, false with a message on std::cerr if it cannot be read or is not valid
+inline bool read_experiment_file(const char * file, experiment_batch & batch) {
+    std::ifstream in(file);
+    if (!in.is_open()) {
+        std::cerr << "cannot open " << file << std::endl;
+        return false;
+    }
+    experiment_job defaults;
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        std::string text = line.substr(0, line.find('#'));
+        if (text.find('=') != std::string::npos) text.replace(text.find('='), 1, " = ");
+        std::istringstream fields(text);
+        std::string key, equals;
+        if (!(fields >> key)) continue;
+        if (key == "[experiment]") {
+            batch.jobs.push_back(defaults);
+            continue;
+        }
+        fields >> equals;
+        bool known = equals == "=";
+        if (!known) {
+        } else if (batch.jobs.empty() && key == "threads") {
+            known = fields >> batch.threads && batch.threads > 0;
+        } else if (batch.jobs.empty() && key == "memory") {
+            known = (bool) (fields >> batch.memory);
+            batch.memory <<= 20;
+        } else if (batch.jobs.empty() && key == "experiment_id") {
+            known = (bool) (fields >> batch.experiment_id);
+        } else {
+            known = read_experiment_key(batch.jobs.empty() ? defaults : batch.jobs.back(), key, fields);
+        }
+        if (!known) {
+            std::cerr << file << " line " << number << ": cannot read \"" << line << "\"" << std::endl;
+            return false;
+        }
+    }
+    if (batch.jobs.empty()) {
+        std::cerr << file << " has no experiments" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < batch.jobs.size(); i++) {
+        if (!check_experiment(batch.jobs[i], i + 1)) return false;
+    }
+    return true;
+}
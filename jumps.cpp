@@ -0,0 +1,129 @@
+#pragma once
+#include "parameters.h"
+#include "rng.cpp"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Where and when a simple random walk leaves a square.
+ *
+ * A RANDOM_WALK agent whose sites within radius along both axes are all
+ * claimed claims nothing until it steps out of that square, onto a site
+ * radius + 1 away. How many moves that takes and which site it steps onto
+ * only depend on the walk, so they are worked out once for a walk starting
+ * in the middle of the square and then drawn in one go. The distribution
+ * is exact up to rounding: the moves are counted up to max_moves, and a
+ * walk still inside by then ends the jump on the site it is on. On the
+ * torus the walk is the same, wrapped around, so the square may be larger
+ * than the torus.
+ */
+
+// one jump: the moves it took and where it ended relative to where it started, outside the square if left
+struct square_exit {
+    int moves;
+    int dx;
+    int dy;
+    bool left;
+};
+
+class square_exits {
+    public:
+        int radius;
+        int max_moves;
+        // the probability of leaving within 1, 2, ..., max_moves moves
+        std::vector<double> moves_cdf;
+        // for every number of moves, the cumulative probabilities of leaving onto each of the ring sites
+        std::vector<std::vector<double>> ring_cdf;
+        std::vector<int> ring_dx, ring_dy;
+        // the cumulative probabilities of the sites of a walk still inside after max_moves moves
+        std::vector<double> inside_cdf;
+
+        square_exits(int radius, int max_moves) {
+            this->radius = radius;
+            this->max_moves = max_moves;
+            int side = 2 * radius + 3;
+            // the index of every site of the square and its ring in the ring sites, -1 inside and at the corners
+            std::vector<int> ring(side * side, -1);
+            for (int dx = -radius - 1; dx <= radius + 1; dx++) {
+                for (int dy = -radius - 1; dy <= radius + 1; dy++) {
+                    bool on_ring = std::max(abs(dx), abs(dy)) == radius + 1;
+                    bool corner = abs(dx) == radius + 1 && abs(dy) == radius + 1;
+                    if (!on_ring || corner) continue;
+                    ring[(dx + radius + 1) * side + dy + radius + 1] = this->ring_dx.size();
+                    this->ring_dx.push_back(dx);
+                    this->ring_dy.push_back(dy);
+                }
+            }
+            // the probability of being on each site of the square without having left, move after move
+            std::vector<double> p(side * side, 0), next(side * side);
+            p[(radius + 1) * side + radius + 1] = 1;
+            double left = 0;
+            for (int t = 1; t <= max_moves; t++) {
+                std::fill(next.begin(), next.end(), 0);
+                std::vector<double> exits(this->ring_dx.size(), 0);
+                for (int dx = -radius; dx <= radius; dx++) {
+                    for (int dy = -radius; dy <= radius; dy++) {
+                        double mass = p[(dx + radius + 1) * side + dy + radius + 1] / 4;
+                        if (mass == 0) continue;
+                        for (int d : {RIGHT, UP, LEFT, DOWN}) {
+                            int site = (dx + dirx[d] + radius + 1) * side + dy + diry[d] + radius + 1;
+                            if (ring[site] >= 0) exits[ring[site]] += mass;
+                            else next[site] += mass;
+                        }
+                    }
+                }
+                p.swap(next);
+                double cumulative = 0;
+                for (double & exit : exits) {
+                    cumulative += exit;
+                    exit = cumulative;
+                }
+                left += cumulative;
+                this->moves_cdf.push_back(left);
+                this->ring_cdf.push_back(exits);
+            }
+            double cumulative = 0;
+            for (int dx = -radius; dx <= radius; dx++) {
+                for (int dy = -radius; dy <= radius; dy++) {
+                    cumulative += p[(dx + radius + 1) * side + dy + radius + 1];
+                    this->inside_cdf.push_back(cumulative);
+                }
+            }
+        }
+
+        // the jumps of walk_jumps
+        static const square_exits & table() {
+            static const square_exits exits(JUMP_RADIUS, JUMP_MOVES);
+            return exits;
+        }
+
+        square_exit sample(rng_stream & rng) const {
+            square_exit exit;
+            double u = rng.next_double();
+            int t = std::upper_bound(this->moves_cdf.begin(), this->moves_cdf.end(), u) - this->moves_cdf.begin();
+            if (t < this->max_moves) {
+                const std::vector<double> & cdf = this->ring_cdf[t];
+                int site = draw(cdf, rng);
+                exit.moves = t + 1;
+                exit.dx = this->ring_dx[site];
+                exit.dy = this->ring_dy[site];
+                exit.left = true;
+                return exit;
+            }
+            int site = draw(this->inside_cdf, rng);
+            exit.moves = this->max_moves;
+            exit.dx = site / (2 * this->radius + 1) - this->radius;
+            exit.dy = site % (2 * this->radius + 1) - this->radius;
+            exit.left = false;
+            return exit;
+        }
+
+    private:
+        // an index drawn with the weights of the cumulative weights cdf
+        static int draw(const std::vector<double> & cdf, rng_stream & rng) {
+            double u = rng.next_double() * cdf.back();
+            int i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+            return std::min(i, (int) cdf.size() - 1);
+        }
+};
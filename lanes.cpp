@@ -0,0 +1,97 @@
+#pragma once
+#include "parameters.h"
+#include "agent.cpp"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * WALK_LANES solo agents on 2D tori of their own, stepped together with
+ * AVX2: the coordinates of all the agents sit in two registers, a step
+ * moves and wraps them all at once and one gather reads the site every
+ * agent lands on. Only the agents that land on a blank site leave the
+ * registers, to claim it with torus_2D::claim.
+ *
+ * The directions are drawn per agent with agent_2D::unmined_direction, from
+ * the agent's own stream, so every agent takes the steps move<strategy_id>()
+ * would take. That holds for RANDOM_WALK and RANDOM_WALK_NB on tori without
+ * mines, row major with 8 bits per site and at most 46340 sites a side, so
+ * that x * n + y fits in a 32 bit lane (see step_lanes_fit).
+ */
+
+// whether step_lanes can step agents on t with the strategy
+inline bool step_lanes_fit(torus_2D * t, int strategy) {
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2 && (strategy == RANDOM_WALK || strategy == RANDOM_WALK_NB)
+        && t->layout == LAYOUT_ROW_MAJOR && t->bits_per_site == 8 && t->size <= 46340;
+#else
+    return false;
+#endif
+}
+
+#if defined(__x86_64__)
+// moves each of the WALK_LANES agents moves times, agent k drawing from rngs[k]
+template <int strategy_id>
+__attribute__((target("avx2")))
+void step_lanes(agent_2D ** agents, rng_stream * rngs, long long moves) {
+    alignas(32) int xs[WALK_LANES], ys[WALK_LANES], directions[WALK_LANES];
+    alignas(32) long long grids[WALK_LANES];
+    int n = agents[0]->t->size;
+    for (int k = 0; k < WALK_LANES; k++) {
+        xs[k] = agents[k]->x;
+        ys[k] = agents[k]->y;
+        grids[k] = (long long) agents[k]->t->grid;
+    }
+    __m256i x = _mm256_load_si256((const __m256i *) xs);
+    __m256i y = _mm256_load_si256((const __m256i *) ys);
+    const __m256i grids_low = _mm256_load_si256((const __m256i *) grids);
+    const __m256i grids_high = _mm256_load_si256((const __m256i *) (grids + 4));
+    const __m256i size = _mm256_set1_epi32(n);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    for (long long i = 0; i < moves; i++) {
+        for (int k = 0; k < WALK_LANES; k++) {
+            directions[k] = agents[k]->template unmined_direction<strategy_id>(rngs[k]);
+        }
+        __m256i d = _mm256_load_si256((const __m256i *) directions);
+        // the compares give -1 where they hold, so these are dirx[d] and diry[d]
+        __m256i dx = _mm256_sub_epi32(_mm256_cmpeq_epi32(d, _mm256_set1_epi32(LEFT)), _mm256_cmpeq_epi32(d, _mm256_set1_epi32(RIGHT)));
+        __m256i dy = _mm256_sub_epi32(_mm256_cmpeq_epi32(d, _mm256_set1_epi32(DOWN)), _mm256_cmpeq_epi32(d, _mm256_set1_epi32(UP)));
+        x = _mm256_add_epi32(x, dx);
+        y = _mm256_add_epi32(y, dy);
+        // wrap -1 to n - 1 and n to 0
+        x = _mm256_add_epi32(x, _mm256_and_si256(_mm256_cmpgt_epi32(zero, x), size));
+        x = _mm256_sub_epi32(x, _mm256_andnot_si256(_mm256_cmpgt_epi32(size, x), size));
+        y = _mm256_add_epi32(y, _mm256_and_si256(_mm256_cmpgt_epi32(zero, y), size));
+        y = _mm256_sub_epi32(y, _mm256_andnot_si256(_mm256_cmpgt_epi32(size, y), size));
+        // the sites as absolute addresses, read as the low byte of 4
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(x, size), y);
+        __m256i low = _mm256_add_epi64(grids_low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(index)));
+        __m256i high = _mm256_add_epi64(grids_high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(index, 1)));
+        __m128i sites_low = _mm256_i64gather_epi32((const int *) 0, low, 1);
+        __m128i sites_high = _mm256_i64gather_epi32((const int *) 0, high, 1);
+        __m256i sites = _mm256_and_si256(_mm256_set_m128i(sites_high, sites_low), low_byte);
+        int blank = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(sites, zero)));
+        if (blank == 0) continue;
+        _mm256_store_si256((__m256i *) xs, x);
+        _mm256_store_si256((__m256i *) ys, y);
+        while (blank != 0) {
+            int k = __builtin_ctz(blank);
+            blank &= blank - 1;
+            agents[k]->t->claim(xs[k], ys[k], agents[k]->id);
+            agents[k]->area_covered++;
+        }
+    }
+    _mm256_store_si256((__m256i *) xs, x);
+    _mm256_store_si256((__m256i *) ys, y);
+    for (int k = 0; k < WALK_LANES; k++) {
+        agents[k]->x = xs[k];
+        agents[k]->y = ys[k];
+    }
+}
+#else
+template <int strategy_id>
+void step_lanes(agent_2D ** agents, rng_stream * rngs, long long moves) {
+}
+#endif
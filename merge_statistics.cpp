@@ -0,0 +1,47 @@
+#include <iostream>
+#include <fstream>
+#include "statistics.cpp"
+
+/*
+ * Merges the statistics of sums files written by shards of the same
+ * experiment (the same scenario and checkpoints, run with different
+ * experiment ids or on different machines) and prints the statistics
+ * section of all their samples together.
+ *
+ * Build with g++ -O2 merge_statistics.cpp -o merge_statistics and run as
+ *   ./merge_statistics SUMS_FILE...
+ */
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " SUMS_FILE..." << std::endl;
+        return 1;
+    }
+    std::vector<statistics_line> merged;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream in(argv[i]);
+        std::vector<statistics_line> lines;
+        if (!read_statistics(in, lines)) {
+            std::cerr << argv[i] << " has no statistics section" << std::endl;
+            return 1;
+        }
+        if (i == 1) {
+            merged = lines;
+            continue;
+        }
+        if (lines.size() != merged.size()) {
+            std::cerr << argv[i] << " has " << lines.size() << " statistics instead of " << merged.size() << std::endl;
+            return 1;
+        }
+        for (size_t j = 0; j < lines.size(); j++) {
+            if (lines[j].name != merged[j].name || lines[j].step != merged[j].step || lines[j].team != merged[j].team) {
+                std::cerr << argv[i] << " line " << j + 1 << " is " << lines[j].name << " " << lines[j].step << " " << lines[j].team
+                          << " instead of " << merged[j].name << " " << merged[j].step << " " << merged[j].team << std::endl;
+                return 1;
+            }
+            merged[j].stats.merge(lines[j].stats);
+        }
+    }
+    write_statistics(std::cout, merged);
+    return 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Bytes of memory that can still be allocated: MemAvailable from
+ * /proc/meminfo, or the free physical pages where that is not available.
+ */
+inline unsigned long long available_memory_bytes() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    unsigned long long kilobytes;
+    while (meminfo >> key >> kilobytes) {
+        if (key == "MemAvailable:") return kilobytes * 1024;
+        meminfo.ignore(256, '\n');
+    }
+    return (unsigned long long) sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+/*
+ * How many workers to run samples on: at most threads, at most one per
+ * sample, and only as many extra workers, each needing worker_bytes for
+ * its own torus, as fit in 90% of the available memory. The first worker
+ * reuses the simulation's torus and is always allowed.
+ */
+inline int worker_count(int threads, int sample_size, unsigned long long worker_bytes) {
+    int workers = std::max(1, std::min(threads, sample_size));
+    if (worker_bytes > 0) {
+        unsigned long long extra = available_memory_bytes() / 10 * 9 / worker_bytes;
+        if ((unsigned long long) workers - 1 > extra) workers = extra + 1;
+    }
+    return workers;
+}
+
+/*
+ * Runs samples first .. sample_size - 1 of sim on up to threads threads.
+ *
+ * The simulation itself is the first worker, the others come from
+ * sim->make_worker() and own a torus and agents of their own. A worker runs
+ * sim->lane_count() samples at a time with simulate_lanes(first, count,
+ * results), and sim->record(sample, result) is then called for the samples
+ * strictly in sample order and one at a time. Since every sample draws from
+ * its own rng streams, the output files and totals are the same for any
+ * number of threads and lanes.
+ */
+template <class Simulation, class Result>
+void simulate_samples(Simulation * sim, int sample_size, int threads, int first = 0) {
+    int lanes = sim->lane_count();
+    int workers = worker_count(threads, (sample_size - first + lanes - 1) / lanes, sim->worker_bytes());
+    if (workers == 1) {
+        std::vector<Result> results(lanes);
+        for (int i = first; i < sample_size; i += lanes) {
+            int count = std::min(lanes, sample_size - i);
+            sim->simulate_lanes(i, count, results);
+            for (int k = 0; k < count; k++) {
+                sim->record(i + k, results[k]);
+            }
+        }
+        return;
+    }
+
+    std::atomic<int> next_sample(first);
+    std::mutex record_lock;
+    std::map<int, Result> finished;
+    int next_to_record = first;
+    auto work = [&](Simulation * worker) {
+        std::vector<Result> results(lanes);
+        for (int group = next_sample.fetch_add(lanes); group < sample_size; group = next_sample.fetch_add(lanes)) {
+            int count = std::min(lanes, sample_size - group);
+            worker->simulate_lanes(group, count, results);
+            std::lock_guard<std::mutex> guard(record_lock);
+            for (int k = 0; k < count; k++) {
+                finished[group + k] = std::move(results[k]);
+            }
+            while (!finished.empty() && finished.begin()->first == next_to_record) {
+                sim->record(next_to_record, finished.begin()->second);
+                finished.erase(finished.begin());
+                next_to_record++;
+            }
+        }
+    };
+
+    std::vector<Simulation *> extra_workers;
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; i++) {
+        extra_workers.push_back(sim->make_worker());
+        pool.push_back(std::thread(work, extra_workers.back()));
+    }
+    work(sim);
+    for (std::thread & thread : pool) {
+        thread.join();
+    }
+    for (Simulation * worker : extra_workers) {
+        delete worker;
+    }
+}
@@ -2,9 +2,58 @@
 
 #define TORUS_SIZE 10001
 
+// bits used per site of a 2D torus: 8, or 4 / 2 to pack the grid
+#define GRID_BITS 8
+
+// memory layout of the torus grids, see torus_2D
+#define LAYOUT_ROW_MAJOR 0
+#define LAYOUT_TILED 1
+#define LAYOUT_MORTON 2
+#define GRID_LAYOUT LAYOUT_ROW_MAJOR
+
+// 2D tiles are TILE_SIDE x TILE_SIDE sites, 4 KB at 8 bits per site
+#define TILE_SIDE 64
+#define TILE_AREA (TILE_SIDE * TILE_SIDE)
+
+// 1D and 2D tori are reset in chunks of RESET_CHUNK bytes, only clearing the
+// chunks written since the last reset
+#define RESET_CHUNK 4096
+
+// 3D tori are stored as bricks of BRICK_SIDE^3 sites, allocated on first write,
+// grouped into superbricks of SUPERBRICK_SIDE^3 bricks
+#define BRICK_SIDE 16
+#define BRICK_VOLUME (BRICK_SIDE * BRICK_SIDE * BRICK_SIDE)
+#define SUPERBRICK_SIDE 16
+#define SUPERBRICK_VOLUME (SUPERBRICK_SIDE * SUPERBRICK_SIDE * SUPERBRICK_SIDE)
+// a site of a 3D torus is found by a key holding its offset in its brick in the low bits,
+// its brick in its superbrick from bit SITE_KEY_BRICK and its superbrick from bit SITE_KEY_SUPERBRICK
+#define SITE_KEY_BRICK 16
+#define SITE_KEY_SUPERBRICK 32
+
+// format of the output file of a simulation: bracketed text, or a binary
+// trajectory file (see trajectory.cpp)
+#define TEXT_OUTPUT 0
+#define BINARY_OUTPUT 1
+
+// relative accuracy of the quantiles in the statistics of the sums files
+#define QUANTILE_ACCURACY 0.01
+
+// a torus_census counts the sites holding each value below CENSUS_VALUES (BLANK and the agent ids)
+#define CENSUS_VALUES 16
+
+// steps between the checks whether the agents have claimed every site they can reach, which ends a sample
+#define COVERAGE_CHECK 256
+
 #define U_LIST_LEN 200
 #define U_LIST_MAX 10
 
+// how the checkpoints of a simulation are laid out (see schedule.cpp): U_LIST_LEN steps scaled
+// with the torus size by default, evenly spaced steps, geometrically spaced steps or a list of steps
+#define SCHEDULE_SCALED 0
+#define SCHEDULE_LINEAR 1
+#define SCHEDULE_LOG 2
+#define SCHEDULE_LIST 3
+
 #define MEMORY 7
 // #define VIKI_MEMORY 1002001
 #define VIKI_MEMORY 5
@@ -19,6 +68,34 @@
 #define DOWN 4
 #define ZDOWN 5
 
+// rng_stream ids of the random choices that do not belong to an agent,
+// agents use their own id
+#define ORDER_STREAM 0
+#define MINES_STREAM 255
+
+// random words drawn at a time for an agent's direction_buffer
+#define DIRECTION_WORDS 64
+
+// solo samples a simulation with walk_lanes runs at once, one per AVX2 lane
+#define WALK_LANES 8
+
+// with jumps, a RANDOM_WALK agent whose sites within JUMP_RADIUS along both axes are all claimed
+// leaves them in one jump of at most JUMP_MOVES moves, looking for such a square after
+// every span of JUMP_IDLE_MOVES moves without a claim; the claims are counted per COVER_BLOCK x COVER_BLOCK block
+#define JUMP_RADIUS 7
+#define JUMP_MOVES 128
+#define JUMP_IDLE_MOVES 4
+#define COVER_BLOCK 8
+
+// points of the coverage curve a 2D simulation with a visits file writes per sample
+#define VISIT_CURVE_POINTS 1000
+
+// the last checkpoint up to which 2D visits can be tracked, as the first_visit stamps are 32 bit
+#define VISIT_STEP_MAX 4294967293LL
+
+// seconds between the snapshots of a simulation with a snapshot_file
+#define SNAPSHOT_SECONDS 300
+
 #define VIKI 0
 #define RANDOM_WALK 1
 #define GREEDY_BIASED 2
@@ -28,6 +105,8 @@
 #define GREEDY_BIASED_ZX 6
 #define VIKI_COLORBLIND 7
 #define RANDOM_WALK_NB 8
+// 3D only: greedy biased within the xy, yz and zx planes in turn, 100 steps each
+#define GREEDY_BIASED_CYCLE 9
 
 const int dirx[] = {1, 0, 0, -1, 0, 0};
 const int diry[] = {0, 1, 0, 0, -1, 0};
@@ -0,0 +1,296 @@
+#pragma once
+#include "parameters.h"
+#include "snapshot.cpp"
+#include <cstdint>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Counter based random numbers.
+ *
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3") maps a 128 bit counter and a 64 bit key to 128 random bits.
+ * An rng_stream uses the experiment id as the key and puts the sample
+ * index and the stream id (the agent id, or one of the *_STREAM ids in
+ * parameters.h) into the upper half of the counter, so every
+ * (experiment, sample, agent) triple gets its own stream that does not
+ * depend on which thread runs the sample or on what other streams drew.
+ */
+
+inline void philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t) 0xD2511F53 * c0;
+        uint64_t p1 = (uint64_t) 0xCD9E8D57 * c2;
+        uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t) p1;
+        c3 = (uint32_t) p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += 0x9E3779B9;
+        k1 += 0xBB67AE85;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/*
+ * Writes the 4 * blocks words of the Philox blocks first, first + 1, ...
+ * of the stream with the given key and upper counter words to out, in the
+ * order rng_stream would return them.
+ */
+inline void philox4x32_blocks_scalar(const uint32_t key[2], uint64_t first, uint32_t c2, uint32_t c3, int blocks, uint32_t * out) {
+    for (int i = 0; i < blocks; i++) {
+        uint64_t block = first + i;
+        uint32_t counter[4] = {(uint32_t) block, (uint32_t) (block >> 32), c2, c3};
+        philox4x32(counter, key, out + 4 * i);
+    }
+}
+
+#if defined(__x86_64__)
+/*
+ * The same as philox4x32_blocks_scalar, computing 8 blocks at a time in
+ * the lanes of AVX2 registers. Only called when the cpu supports AVX2.
+ */
+__attribute__((target("avx2")))
+inline void philox4x32_blocks_avx2(const uint32_t key[2], uint64_t first, uint32_t c2, uint32_t c3, int blocks, uint32_t * out) {
+    const __m256i m0 = _mm256_set1_epi64x(0xD2511F53);
+    const __m256i m1 = _mm256_set1_epi64x(0xCD9E8D57);
+    int i = 0;
+    for (; i + 8 <= blocks; i += 8) {
+        uint32_t low[8], high[8];
+        for (int lane = 0; lane < 8; lane++) {
+            uint64_t block = first + i + lane;
+            low[lane] = (uint32_t) block;
+            high[lane] = (uint32_t) (block >> 32);
+        }
+        __m256i x0 = _mm256_loadu_si256((const __m256i *) low);
+        __m256i x1 = _mm256_loadu_si256((const __m256i *) high);
+        __m256i x2 = _mm256_set1_epi32(c2);
+        __m256i x3 = _mm256_set1_epi32(c3);
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            // 32 x 32 -> 64 bit products of the even and the odd lanes
+            __m256i p0_even = _mm256_mul_epu32(x0, m0);
+            __m256i p0_odd = _mm256_mul_epu32(_mm256_srli_epi64(x0, 32), m0);
+            __m256i p1_even = _mm256_mul_epu32(x2, m1);
+            __m256i p1_odd = _mm256_mul_epu32(_mm256_srli_epi64(x2, 32), m1);
+            __m256i lo0 = _mm256_blend_epi32(p0_even, _mm256_slli_epi64(p0_odd, 32), 0xAA);
+            __m256i hi0 = _mm256_blend_epi32(_mm256_srli_epi64(p0_even, 32), p0_odd, 0xAA);
+            __m256i lo1 = _mm256_blend_epi32(p1_even, _mm256_slli_epi64(p1_odd, 32), 0xAA);
+            __m256i hi1 = _mm256_blend_epi32(_mm256_srli_epi64(p1_even, 32), p1_odd, 0xAA);
+            x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32(k0));
+            x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32(k1));
+            x1 = lo1;
+            x3 = lo0;
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        uint32_t words[4][8];
+        _mm256_storeu_si256((__m256i *) words[0], x0);
+        _mm256_storeu_si256((__m256i *) words[1], x1);
+        _mm256_storeu_si256((__m256i *) words[2], x2);
+        _mm256_storeu_si256((__m256i *) words[3], x3);
+        for (int lane = 0; lane < 8; lane++) {
+            for (int w = 0; w < 4; w++) {
+                out[4 * (i + lane) + w] = words[w][lane];
+            }
+        }
+    }
+    philox4x32_blocks_scalar(key, first + i, c2, c3, blocks - i, out + 4 * i);
+}
+#endif
+
+inline void philox4x32_blocks(const uint32_t key[2], uint64_t first, uint32_t c2, uint32_t c3, int blocks, uint32_t * out) {
+#if defined(__x86_64__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        philox4x32_blocks_avx2(key, first, c2, c3, blocks, out);
+        return;
+    }
+#endif
+    philox4x32_blocks_scalar(key, first, c2, c3, blocks, out);
+}
+
+class rng_stream {
+    public:
+        uint32_t key[2];
+        uint32_t counter[4];
+        uint32_t block[4];
+        int used;
+        uint32_t coin_bits;
+        int coins_left;
+
+        rng_stream() {
+            seed(0, 0, 0);
+        }
+
+        rng_stream(unsigned long long experiment, unsigned int sample, unsigned int stream) {
+            seed(experiment, sample, stream);
+        }
+
+        void seed(unsigned long long experiment, unsigned int sample, unsigned int stream) {
+            this->key[0] = (uint32_t) experiment;
+            this->key[1] = (uint32_t) (experiment >> 32);
+            this->counter[0] = 0;
+            this->counter[1] = 0;
+            this->counter[2] = sample;
+            this->counter[3] = stream;
+            this->used = 4;
+            this->coins_left = 0;
+        }
+
+        uint32_t next_u32() {
+            if (this->used == 4) {
+                philox4x32(this->counter, this->key, this->block);
+                if (++this->counter[0] == 0) this->counter[1]++;
+                this->used = 0;
+            }
+            return this->block[this->used++];
+        }
+
+        // writes the next n words of the stream to out, generating whole blocks in bulk
+        void fill(uint32_t * out, int n) {
+            int i = 0;
+            while (i < n && this->used < 4) {
+                out[i++] = this->block[this->used++];
+            }
+            int blocks = (n - i) / 4;
+            uint64_t first = (uint64_t) this->counter[1] << 32 | this->counter[0];
+            philox4x32_blocks(this->key, first, this->counter[2], this->counter[3], blocks, out + i);
+            this->counter[0] = (uint32_t) (first + blocks);
+            this->counter[1] = (uint32_t) ((first + blocks) >> 32);
+            i += 4 * blocks;
+            while (i < n) {
+                out[i++] = next_u32();
+            }
+        }
+
+        uint64_t next_u64() {
+            uint64_t hi = next_u32();
+            return hi << 32 | next_u32();
+        }
+
+        // uniform in [0, n), without modulo bias (Lemire's method)
+        uint32_t uniform(uint32_t n) {
+            uint64_t m = (uint64_t) next_u32() * n;
+            uint32_t low = (uint32_t) m;
+            if (low < n) {
+                uint32_t threshold = -n % n;
+                while (low < threshold) {
+                    m = (uint64_t) next_u32() * n;
+                    low = (uint32_t) m;
+                }
+            }
+            return m >> 32;
+        }
+
+        // uniform in [0, 1)
+        double next_double() {
+            return (next_u64() >> 11) * 0x1.0p-53;
+        }
+
+        // one random bit, using all 32 bits of a word before drawing the next
+        bool coin() {
+            if (this->coins_left == 0) {
+                this->coin_bits = next_u32();
+                this->coins_left = 32;
+            }
+            bool res = this->coin_bits & 1;
+            this->coin_bits >>= 1;
+            this->coins_left--;
+            return res;
+        }
+
+        void save(std::ostream & out) {
+            save_value(out, *this);
+        }
+
+        void load(std::istream & in) {
+            load_value(in, *this);
+        }
+};
+
+/*
+ * Random directions for an agent, generated DIRECTION_WORDS words at a
+ * time from the agent's stream. choices is 2, 4 or 6. For 2 and 4 every
+ * word is sliced into 32 or 16 directions of 1 or 2 bits. For 6 every byte
+ * below 252 = 42 * 6 gives the direction byte % 6 and the larger bytes are
+ * dropped, so the directions stay unbiased.
+ *
+ * clear() has to be called when a sample starts so that no directions of
+ * the previous sample are used.
+ */
+class direction_buffer {
+    public:
+        int choices;
+        int next_index = 0;
+        int filled = 0;
+        uint32_t words[DIRECTION_WORDS];
+        uint8_t directions[DIRECTION_WORDS * 32];
+
+        direction_buffer(int choices) {
+            this->choices = choices;
+        }
+
+        void clear() {
+            this->next_index = 0;
+            this->filled = 0;
+        }
+
+        // a uniform direction in [0, choices)
+        int next(rng_stream & rng) {
+            if (this->next_index == this->filled) refill(rng);
+            return this->directions[this->next_index++];
+        }
+
+        void refill(rng_stream & rng) {
+            rng.fill(this->words, DIRECTION_WORDS);
+            if (this->choices == 2) {
+                for (int i = 0; i < DIRECTION_WORDS; i++) {
+                    for (int j = 0; j < 32; j++) {
+                        this->directions[32 * i + j] = (this->words[i] >> j) & 1;
+                    }
+                }
+                this->filled = 32 * DIRECTION_WORDS;
+            } else if (this->choices == 4) {
+                for (int i = 0; i < DIRECTION_WORDS; i++) {
+                    for (int j = 0; j < 16; j++) {
+                        this->directions[16 * i + j] = (this->words[i] >> (2 * j)) & 3;
+                    }
+                }
+                this->filled = 16 * DIRECTION_WORDS;
+            } else {
+                const uint8_t * bytes = (const uint8_t *) this->words;
+                int count = 0;
+                for (int i = 0; i < 4 * DIRECTION_WORDS; i++) {
+                    this->directions[count] = bytes[i] % 6;
+                    count += bytes[i] < 252;
+                }
+                this->filled = count;
+            }
+            this->next_index = 0;
+        }
+
+        // the directions not used yet, the drawn words are not needed again
+        void save(std::ostream & out) {
+            save_value(out, this->next_index);
+            save_value(out, this->filled);
+            out.write((const char *) this->directions, this->filled);
+        }
+
+        void load(std::istream & in) {
+            load_value(in, this->next_index);
+            load_value(in, this->filled);
+            if (this->filled < 0 || this->filled > DIRECTION_WORDS * 32 || this->next_index < 0 || this->next_index > this->filled) {
+                in.setstate(std::ios::failbit);
+                return;
+            }
+            in.read((char *) this->directions, this->filled);
+        }
+};
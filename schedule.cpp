@@ -0,0 +1,54 @@
+#pragma once
+#include "parameters.h"
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+/*
+ * A checkpoint schedule, the steps at which a simulation records the areas
+ * covered, given at runtime:
+ *
+ *     SCHEDULE_SCALED  count steps u * n^2 log n in 2D and u * n^3 in 3D
+ *                      for u evenly spaced up to max, and the step n^2 in
+ *                      1D (the default, U_LIST_LEN and U_LIST_MAX)
+ *     SCHEDULE_LINEAR  count steps evenly spaced up to last
+ *     SCHEDULE_LOG     count steps spaced geometrically from first to
+ *                      last, dense early and sparse late
+ *     SCHEDULE_LIST    the steps listed, increasing
+ *
+ * Rounded steps that coincide are kept once.
+ */
+struct checkpoint_schedule {
+    int kind = SCHEDULE_SCALED;
+    int count = U_LIST_LEN;
+    double max = U_LIST_MAX;
+    long long first = 1;
+    long long last = 0;
+    std::vector<long long> steps;
+};
+
+// the checkpoints of schedule on a torus of n sites a side in the dimension
+inline std::vector<long long> checkpoint_steps(const checkpoint_schedule & schedule, int dimension, int n) {
+    std::vector<long long> steps;
+    if (schedule.kind == SCHEDULE_LIST) {
+        steps = schedule.steps;
+    } else if (schedule.kind == SCHEDULE_SCALED && dimension == 1) {
+        steps.push_back((long long) n * n);
+    } else {
+        for (int i = 0; i < schedule.count; i++) {
+            double step = 0;
+            if (schedule.kind == SCHEDULE_SCALED) {
+                double u_step = schedule.max / schedule.count;
+                step = dimension == 2 ? (i + 1) * u_step * n * n * log(n) : (i + 1) * u_step * n * n * n;
+            }
+            if (schedule.kind == SCHEDULE_LINEAR) step = (double) (i + 1) * schedule.last / schedule.count;
+            if (schedule.kind == SCHEDULE_LOG) {
+                double ratio = schedule.count > 1 ? (double) i / (schedule.count - 1) : 1;
+                step = schedule.first * pow((double) schedule.last / schedule.first, ratio);
+            }
+            steps.push_back(std::max(1LL, (long long) round(step)));
+        }
+    }
+    steps.erase(std::unique(steps.begin(), steps.end()), steps.end());
+    return steps;
+}
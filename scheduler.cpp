@@ -0,0 +1,432 @@
+#pragma once
+#include "simulate.cpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <string>
+
+/*
+ * One experiment of a batch. dimension is 1, 2 or 3. scenario names the
+ * simulation class to run (see scenario_presets), and when it is empty
+ * the dimension, the number of strategies and the mine chance pick one
+ * of 1D_1v1, 2D, 2D_solo_mines, 2D_1v1, 2D_1v1_mines and 3D_1v1.
+ * strategies holds the strategy of every agent of the scenario in the
+ * order of its constructor; they are ignored in 1D, where the second
+ * agent starts at second_position. A mine_chance above 0 puts mines on
+ * the 2D torus, and a distance other than -1 starts the agents of
+ * 2D_1v1_interface that far apart. file and file_sums are the torus and
+ * interface files in 1D.
+ * output_format is TEXT_OUTPUT or BINARY_OUTPUT. With walk_lanes a solo 2D
+ * experiment runs WALK_LANES samples at a time on every thread where it
+ * can (see simulate_lanes), each on a torus of its own, and with jumps a
+ * solo RANDOM_WALK agent jumps out of claimed squares (see walk_jumps).
+ * With a visits_file a 2D experiment writes the cover time and coverage
+ * curve of every sample there (see start_visits).
+ * With a snapshot_file the simulation saves snapshots there and resumes
+ * from it when run again. The samples are recorded at the checkpoints of
+ * schedule, and in 2D at the steps the agents reach the coverage fractions
+ * of the sites.
+ */
+struct experiment_job {
+    int dimension = 2;
+    std::string scenario;
+    std::vector<int> strategies = {RANDOM_WALK};
+    double mine_chance = 0;
+    int distance = -1;
+    int sample_size = 1;
+    int torus_size = TORUS_SIZE;
+    int second_position = 1;
+    int output_format = TEXT_OUTPUT;
+    bool walk_lanes = false;
+    bool jumps = false;
+    checkpoint_schedule schedule;
+    std::vector<double> coverage;
+    std::string file;
+    std::string visits_file;
+    std::string file_sums;
+    std::string snapshot_file;
+};
+
+/*
+ * A scenario an experiment_job can run, named after the scenario of its
+ * simulation class: the dimension of its torus, how many strategies it
+ * takes (0 in 1D), how many moves its agents make per step together, and
+ * whether it takes a mine chance or a starting distance.
+ */
+struct scenario_preset {
+    const char * name;
+    int dimension;
+    int agents;
+    int moves;
+    bool mines;
+    bool distance;
+};
+
+const scenario_preset scenario_presets[] = {
+    {"1D_1v1", 1, 0, 2, false, false},
+    {"2D", 2, 1, 1, false, false},
+    {"2D_solo_mines", 2, 1, 1, true, false},
+    {"2D_1v1", 2, 2, 2, false, false},
+    {"2D_1v1_interface", 2, 2, 2, false, true},
+    {"2D_1v1_mines", 2, 2, 2, true, false},
+    {"2D_1v3", 2, 4, 6, false, false},
+    {"3_collab_2D", 2, 3, 3, false, false},
+    {"3D_1v1", 3, 2, 2, false, false},
+    {"3D_3v3", 3, 6, 6, false, false},
+    {"3D_1v3", 3, 4, 6, false, false},
+};
+
+// the preset named name, NULL if there is none
+inline const scenario_preset * find_scenario(const std::string & name) {
+    for (const scenario_preset & preset : scenario_presets) {
+        if (name == preset.name) return &preset;
+    }
+    return NULL;
+}
+
+// the scenario e runs: its own, or the one its dimension, strategies and mine chance imply
+inline std::string scenario_name(const experiment_job & e) {
+    if (!e.scenario.empty()) return e.scenario;
+    if (e.dimension == 1) return "1D_1v1";
+    if (e.dimension == 3) return "3D_1v1";
+    if (e.strategies.size() == 1) return e.mine_chance > 0 ? "2D_solo_mines" : "2D";
+    return e.mine_chance > 0 ? "2D_1v1_mines" : "2D_1v1";
+}
+
+// builds the simulation of the 2D scenario name for e, with a new agent on t for each of its strategies
+inline simulation<2> * make_scenario_2D(const std::string & name, const experiment_job & e, torus_2D * t, unsigned long long experiment_id) {
+    std::vector<agent_2D *> a;
+    for (size_t k = 0; k < e.strategies.size(); k++) {
+        a.push_back(new agent_2D(t, e.strategies[k], k + 1));
+    }
+    const char * file = e.file.c_str();
+    const char * sums = e.file_sums.c_str();
+    if (name == "2D_solo_mines") return new simulation_2D_solo_mines(a[0], e.mine_chance, e.sample_size, file, sums, experiment_id);
+    if (name == "2D_1v1") return new simulation_2D_1v1(a[0], a[1], e.sample_size, file, sums, experiment_id);
+    if (name == "2D_1v1_interface") return new simulation_2D_1v1_interface(a[0], a[1], e.sample_size, file, sums, e.distance, experiment_id);
+    if (name == "2D_1v1_mines") return new simulation_2D_1v1_mines(a[0], a[1], e.mine_chance, e.sample_size, file, sums, experiment_id);
+    if (name == "2D_1v3") return new simulation_2D_1v3(a[0], a[1], a[2], a[3], e.sample_size, file, sums, experiment_id);
+    if (name == "3_collab_2D") return new simulation_3_collab_2D(a[0], a[1], a[2], e.sample_size, file, sums, experiment_id);
+    return new simulation_2D(a[0], e.sample_size, file, sums, experiment_id);
+}
+
+// builds the simulation of the 3D scenario name for e, with a new agent on t for each of its strategies
+inline simulation<3> * make_scenario_3D(const std::string & name, const experiment_job & e, torus_3D * t, unsigned long long experiment_id) {
+    std::vector<agent_3D *> a;
+    for (size_t k = 0; k < e.strategies.size(); k++) {
+        a.push_back(new agent_3D(t, e.strategies[k], k + 1));
+    }
+    const char * file = e.file.c_str();
+    const char * sums = e.file_sums.c_str();
+    if (name == "3D_3v3") return new simulation_3D_3v3(a[0], a[1], a[2], a[3], a[4], a[5], e.sample_size, file, sums, experiment_id);
+    if (name == "3D_1v3") return new simulation_3D_1v3(a[0], a[1], a[2], a[3], e.sample_size, file, sums, experiment_id);
+    return new simulation_3D_1v1(a[0], a[1], e.sample_size, file, sums, experiment_id);
+}
+
+// sets what every simulation built for an experiment_job shares, its torus going back to pool
+template <class Simulation>
+Simulation * configure_simulation(Simulation * sim, const experiment_job & e, torus_pool<typename Simulation::torus_type> * pool) {
+    sim->owns_agents = true;
+    sim->pool = pool;
+    sim->set_schedule(e.schedule);
+    sim->set_coverage_fractions(e.coverage);
+    sim->output_format = e.output_format;
+    sim->snapshot_file = e.snapshot_file;
+    sim->walk_lanes = e.walk_lanes;
+    sim->jumps = e.jumps;
+    sim->visits_file_name = e.visits_file;
+    return sim;
+}
+
+/*
+ * A job of the scheduler, split into chunks of samples. Every thread that
+ * runs a chunk of the job needs a worker of its own for it, which takes
+ * worker_bytes() of memory until the whole job is finished.
+ */
+class scheduled_job {
+    public:
+        int id;
+        int sample_size;
+
+        virtual ~scheduled_job() {}
+        virtual unsigned long long worker_bytes() = 0;
+        virtual bool has_worker(int thread) = 0;
+        // runs samples first .. last - 1, returns the number of workers freed when this finishes the job
+        virtual int run_chunk(int thread, int first, int last) = 0;
+};
+
+/*
+ * A scheduled_job running a simulation class. The first thread to run a
+ * chunk builds the simulation with make_simulation (which writes the output
+ * files), the other threads get workers from its make_worker(). The
+ * samples are recorded in sample order as in simulate_samples(). Once the
+ * simulation and its workers are deleted, on_finish is called if set.
+ */
+template <class Simulation, class Result>
+class simulation_job : public scheduled_job {
+    public:
+        std::function<Simulation * ()> make_simulation;
+        std::function<void ()> on_finish;
+        Simulation * sim = NULL;
+        std::vector<Simulation *> workers;
+        unsigned long long bytes = 0;
+        std::mutex lock;
+        std::map<int, Result> finished;
+        int next_to_record = 0;
+        int samples_done = 0;
+        std::chrono::time_point<std::chrono::system_clock> start;
+
+        simulation_job(int id, int sample_size, int threads, unsigned long long bytes, std::function<Simulation * ()> make_simulation, std::function<void ()> on_finish) {
+            this->id = id;
+            this->sample_size = sample_size;
+            this->bytes = bytes;
+            this->make_simulation = make_simulation;
+            this->on_finish = on_finish;
+            this->workers.assign(threads, NULL);
+        }
+
+        unsigned long long worker_bytes() {
+            return this->bytes;
+        }
+
+        bool has_worker(int thread) {
+            return this->workers[thread] != NULL;
+        }
+
+        int run_chunk(int thread, int first, int last) {
+            if (this->workers[thread] == NULL) {
+                std::lock_guard<std::mutex> guard(this->lock);
+                if (this->sim == NULL) {
+                    this->sim = this->make_simulation();
+                    this->start = std::chrono::system_clock::now();
+                    this->sim->start_output();
+                    std::cout << "Simulation " << this->id << " starting with experiment id " << this->sim->experiment_id << "..." << std::endl;
+                    this->next_to_record = this->sim->first_sample;
+                    this->workers[thread] = this->sim;
+                } else {
+                    this->workers[thread] = this->sim->make_worker();
+                }
+            }
+            Simulation * worker = this->workers[thread];
+            int lanes = worker->lane_count();
+            std::vector<Result> results(lanes);
+            // the samples before first_sample were recorded before the run was resumed
+            for (int group = std::max(first, this->sim->first_sample); group < last; group += lanes) {
+                int count = std::min(lanes, last - group);
+                worker->simulate_lanes(group, count, results);
+                std::lock_guard<std::mutex> guard(this->lock);
+                for (int k = 0; k < count; k++) {
+                    this->finished[group + k] = std::move(results[k]);
+                }
+                while (!this->finished.empty() && this->finished.begin()->first == this->next_to_record) {
+                    this->sim->record(this->next_to_record, this->finished.begin()->second);
+                    this->finished.erase(this->finished.begin());
+                    this->next_to_record++;
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->samples_done += last - first;
+            if (this->samples_done < this->sample_size) return 0;
+            this->sim->finish_output();
+            auto end = std::chrono::system_clock::now();
+            std::chrono::duration<double> elapsed = end - this->start;
+            std::cout << "Elapsed time for simulation " << this->id << ": " << elapsed.count() << "s" << std::endl;
+            int freed = 0;
+            for (Simulation *& w : this->workers) {
+                if (w != NULL) {
+                    if (w != this->sim) delete w;
+                    w = NULL;
+                    freed++;
+                }
+            }
+            delete this->sim;
+            this->sim = NULL;
+            if (this->on_finish) this->on_finish();
+            return freed;
+        }
+};
+
+struct sample_chunk {
+    scheduled_job * job;
+    int first;
+    int last;
+};
+
+/*
+ * Runs a batch of jobs on threads threads.
+ *
+ * The jobs are cut into chunks of about sample_size / (4 * threads)
+ * samples, which are dealt round robin onto one deque per thread. A thread
+ * takes chunks from the front of its own deque and, once that is empty,
+ * steals from the back of the others, so a long job is spread over every
+ * thread until its last chunk. Every deque has a lock of its own, so
+ * threads only contend when they take from the same deque. A thread only
+ * takes a chunk of a job it has no worker for yet when the worker still
+ * fits in memory_budget bytes, which admit() checks under memory_lock;
+ * otherwise it looks for a chunk of a job it already has a worker for, or
+ * waits until a finished job frees its workers. A job on its own is always
+ * admitted, so a job larger than the budget still runs, on one thread.
+ * The experiment_jobs of a batch share their tori through one torus_pool
+ * per dimension, so a job takes over the tori of an earlier job of the
+ * same size instead of allocating its own.
+ */
+class experiment_scheduler {
+    public:
+        int threads;
+        unsigned long long memory_budget;
+        unsigned long long memory_used = 0;
+        // how many times finished jobs have freed workers, for the threads waiting on memory_freed
+        unsigned long long frees = 0;
+        std::atomic<int> chunks_queued{0};
+        std::vector<scheduled_job *> jobs;
+        std::vector<std::deque<sample_chunk>> queues;
+        std::vector<std::mutex> queue_locks;
+        std::mutex memory_lock;
+        std::condition_variable memory_freed;
+        torus_pool<torus_1D> tori_1D;
+        torus_pool<torus_2D> tori_2D;
+        torus_pool<torus_3D> tori_3D;
+
+        experiment_scheduler(int threads, unsigned long long memory_budget = available_memory_bytes() / 10 * 9) : queues(std::max(1, threads)), queue_locks(std::max(1, threads)) {
+            this->threads = std::max(1, threads);
+            this->memory_budget = memory_budget;
+        }
+
+        ~experiment_scheduler() {
+            for (scheduled_job * job : this->jobs) {
+                delete job;
+            }
+        }
+
+        template <class Simulation, class Result>
+        void add(int sample_size, std::function<Simulation * ()> make_simulation, unsigned long long worker_bytes, std::function<void ()> on_finish = nullptr) {
+            int id = this->jobs.size() + 1;
+            this->jobs.push_back(new simulation_job<Simulation, Result>(id, sample_size, this->threads, worker_bytes, make_simulation, on_finish));
+        }
+
+        // adds the simulation an experiment_job passing check_experiment describes, with experiment id base_id + its index in the batch
+        void add(experiment_job & e, unsigned long long base_id) {
+            unsigned long long experiment_id = base_id + this->jobs.size();
+            const scenario_preset * preset = find_scenario(scenario_name(e));
+            std::string name = preset->name;
+            int n = e.torus_size;
+            // about the size of a 2D grid, before the padding of the tiled layouts
+            unsigned long long grid_bytes = (unsigned long long) n * n * GRID_BITS / 8;
+            // tracking visits takes the first_visit grid and keeps the samples out of the lanes
+            if (e.dimension == 2 && (!e.visits_file.empty() || !e.coverage.empty())) grid_bytes += 4ULL * n * n;
+            else if (e.dimension == 2 && preset->agents == 1 && e.walk_lanes) grid_bytes *= WALK_LANES;
+            if (e.dimension == 1) {
+                torus_pool<torus_1D> * tori = &this->tori_1D;
+                tori->expect(n);
+                add<simulation<1>, sample_result>(e.sample_size, [e, experiment_id, tori]() {
+                    torus_1D * t = tori->take(e.torus_size);
+                    simulation_1D_1v1 * sim = new simulation_1D_1v1(new agent_1D(t, 1, 0), new agent_1D(t, 2, e.second_position), e.sample_size, e.file.c_str(), e.file_sums.c_str(), experiment_id);
+                    return configure_simulation(sim, e, tori);
+                }, n, [tori, n]() { tori->done(n); });
+            } else if (e.dimension == 2) {
+                torus_pool<torus_2D> * tori = &this->tori_2D;
+                tori->expect(n);
+                add<simulation<2>, sample_result>(e.sample_size, [e, name, experiment_id, tori]() {
+                    return configure_simulation(make_scenario_2D(name, e, tori->take(e.torus_size), experiment_id), e, tori);
+                }, grid_bytes, [tori, n]() { tori->done(n); });
+            } else {
+                // every move claims at most one site
+                unsigned long long moves = preset->moves * (unsigned long long) checkpoint_steps(e.schedule, 3, n).back();
+                torus_pool<torus_3D> * tori = &this->tori_3D;
+                tori->expect(n);
+                add<simulation<3>, sample_result>(e.sample_size, [e, name, experiment_id, tori]() {
+                    return configure_simulation(make_scenario_3D(name, e, tori->take(e.torus_size), experiment_id), e, tori);
+                }, torus_3D::max_allocated_bytes(n, moves), [tori, n]() { tori->done(n); });
+            }
+        }
+
+        void run() {
+            int chunk_count = 0;
+            for (scheduled_job * job : this->jobs) {
+                int chunk_size = std::max(1, job->sample_size / (4 * this->threads));
+                for (int first = 0; first < job->sample_size; first += chunk_size) {
+                    sample_chunk chunk = {job, first, std::min(job->sample_size, first + chunk_size)};
+                    this->queues[chunk_count % this->threads].push_back(chunk);
+                    chunk_count++;
+                }
+            }
+            this->chunks_queued = chunk_count;
+
+            std::vector<std::thread> pool;
+            for (int i = 1; i < this->threads; i++) {
+                pool.push_back(std::thread(&experiment_scheduler::work, this, i));
+            }
+            work(0);
+            for (std::thread & thread : pool) {
+                thread.join();
+            }
+        }
+
+    private:
+        void work(int thread) {
+            sample_chunk chunk;
+            while (take_chunk(thread, chunk)) {
+                int freed = chunk.job->run_chunk(thread, chunk.first, chunk.last);
+                if (freed > 0) {
+                    std::lock_guard<std::mutex> guard(this->memory_lock);
+                    this->memory_used -= freed * chunk.job->worker_bytes();
+                    this->frees++;
+                    this->memory_freed.notify_all();
+                }
+            }
+        }
+
+        // whether a new worker for job fits, reserving its memory if it does
+        bool admit(scheduled_job * job) {
+            std::lock_guard<std::mutex> guard(this->memory_lock);
+            if (this->memory_used > 0 && this->memory_used + job->worker_bytes() > this->memory_budget) return false;
+            this->memory_used += job->worker_bytes();
+            return true;
+        }
+
+        // takes a chunk the thread can run now, waiting for memory if there is none; false once every chunk is taken
+        bool take_chunk(int thread, sample_chunk & chunk) {
+            while (this->chunks_queued > 0) {
+                unsigned long long seen;
+                {
+                    std::lock_guard<std::mutex> guard(this->memory_lock);
+                    seen = this->frees;
+                }
+                for (int i = 0; i < this->threads; i++) {
+                    if (take_from((thread + i) % this->threads, thread, chunk)) return true;
+                }
+                // a free after seen was read may admit a chunk the scan passed over
+                std::unique_lock<std::mutex> memory(this->memory_lock);
+                this->memory_freed.wait(memory, [&]() { return this->chunks_queued == 0 || this->frees != seen; });
+            }
+            return false;
+        }
+
+        // takes a chunk the thread can run now from the deque of victim, holding only its lock
+        bool take_from(int victim, int thread, sample_chunk & chunk) {
+            std::lock_guard<std::mutex> guard(this->queue_locks[victim]);
+            std::deque<sample_chunk> & queue = this->queues[victim];
+            scheduled_job * refused = NULL;
+            for (int j = 0; j < (int) queue.size(); j++) {
+                // the front of the own deque, the back of the others
+                int k = victim == thread ? j : (int) queue.size() - 1 - j;
+                scheduled_job * job = queue[k].job;
+                if (job == refused) continue;
+                if (!job->has_worker(thread) && !admit(job)) {
+                    refused = job;
+                    continue;
+                }
+                chunk = queue[k];
+                queue.erase(queue.begin() + k);
+                if (--this->chunks_queued == 0) {
+                    // wakes the threads waiting for memory, there is nothing left for them
+                    std::lock_guard<std::mutex> memory(this->memory_lock);
+                    this->memory_freed.notify_all();
+                }
+                return true;
+            }
+            return false;
+        }
+};
@@ -1,819 +1,1285 @@
 #include "agent.cpp"
+#include "arcs.cpp"
+#include "census.cpp"
+#include "jumps.cpp"
+#include "lanes.cpp"
+#include "parallel.cpp"
+#include "schedule.cpp"
+#include "statistics.cpp"
+#include "trajectory.cpp"
 #include <chrono>
 #include <ctime>
 #include <stdlib.h>
 #include <fstream>
 #include <iostream>
 #include <math.h>
+#include <sstream>
+#include <vector>
 
 /*
- * Simulates a competition between two agents in 1D.
- * 
- * The output file will hold the total areas covered at the specified
- * u values by each agent.  
+ * What a sample hands from the worker that ran it to record(): the area
+ * covered at every checkpoint, team after team within a checkpoint, the
+ * interface length where the simulation measures it and, in 1D, the sites
+ * that differ from their right neighbour.
+ */
+struct sample_result {
+    std::vector<unsigned long long> areas;
+    // the interface at every checkpoint, when it is tracked, and at the end
+    std::vector<long> interfaces;
+    long interface = 0;
+    std::vector<int> interface_sites;
+    // when visits are tracked, the step the torus was covered at (-1 if it was not), the site claimed last and the coverage curve
+    long long cover_time = -1;
+    long long last_site = -1;
+    std::vector<unsigned long long> curve;
+    // the step the agents reached each of the coverage fractions at, -1 where they did not
+    std::vector<long long> coverage_steps;
+};
+
+// where the step loop of a sample is: the next step, the next checkpoint and whether the torus is covered
+struct step_position {
+    long long step = 0;
+    size_t checkpoint = 0;
+    bool covered = false;
+};
+
+const char run_snapshot_magic[8] = {'R', 'W', 'R', 'U', 'N', 'S', '0', '1'};
+const char sample_snapshot_magic[8] = {'R', 'W', 'S', 'M', 'P', 'L', '0', '1'};
+
+// the torus and agent classes of a dimension
+template <int dimension> struct lattice;
+template <> struct lattice<1> { typedef torus_1D torus; typedef agent_1D agent; };
+template <> struct lattice<2> { typedef torus_2D torus; typedef agent_2D agent; };
+template <> struct lattice<3> { typedef torus_3D torus; typedef agent_3D agent; };
+
+/*
+ * The simulation engine: one or two teams of agents walking on a torus of
+ * the given dimension.
+ *
+ * Every step each team moves in turn, each agent of a team
+ * moves_per_step[team] times in a row, and with two teams a coin decides
+ * which team goes first. Once every site they can reach is claimed the
+ * agents stop moving.
+ * The areas the teams covered are recorded at checkpoints, by default the
+ * steps u * n^2 log n in 2D and u * n^3 in 3D for the U_LIST_LEN values
+ * of u up to U_LIST_MAX, and the single step n^2 in 1D, or at those of
+ * another checkpoint_schedule (see set_schedule). In 2D the steps at which
+ * the agents claim given fractions of the sites can be recorded as well
+ * (see set_coverage_fractions).
+ *
+ * The torus is blank at the start of a sample, or in 2D mined with
+ * mine_chance when that is above 0. The agents start at random sites, or
+ * when distance is not -1 the first at the origin and the second at
+ * that Manhattan distance from it. measure_interface adds the length of the
+ * border between agent 1 and agent 2 at every checkpoint of a 2D sample,
+ * which the torus keeps up to date as sites are claimed; the 1D torus
+ * keeps the number of sites differing from their neighbour the same way.
+ *
+ * The output file holds the areas covered at every checkpoint of every
+ * sample and the sums file their totals over the samples. In 1D the output
+ * file instead lists the sites differing from their right neighbour and
+ * the sums file their count, one sample per line. With output_format
+ * BINARY_OUTPUT the output file is a trajectory file (see trajectory.cpp)
+ * holding the same numbers, the sums file stays text. Without an output
+ * file name no per-sample output is written at all. The sums file ends
+ * with the statistics of the areas at every checkpoint and of the
+ * interface (see statistics.cpp), which in 1D go to a file of their own,
+ * the sums file name with .stats appended.
+ *
+ * The scenario classes below set this up for the experiments in
+ * cpptesting.cpp.
  */
-class simulation_1D_1v1 {
+template <int dimension>
+class simulation {
     public:
-        agent_1D * agent1 = NULL;
-        agent_1D * agent2 = NULL;
+        typedef typename lattice<dimension>::torus torus_type;
+        typedef typename lattice<dimension>::agent agent_type;
+
+        std::vector<std::vector<agent_type *>> teams;
+        std::vector<int> moves_per_step;
+        std::vector<agent_type *> agents;
+        torus_type * t;
+        std::vector<long long> checkpoints;
         int sample_size = 1;
-        std::ofstream torus_file;
-        std::ofstream interface_file;
-        unsigned long long interface_size;
+        unsigned long long experiment_id;
+        int threads = 1;
+        bool owns_agents = false;
+        double mine_chance = 0;
+        int distance = -1;
+        bool measure_interface = false;
+        std::string scenario = "simulation";
+        int output_format = TEXT_OUTPUT;
+        std::string output_file_name;
+        std::string output_file_sums_name;
+        std::ofstream output_file;
+        std::ofstream output_file_sums;
+        std::vector<unsigned char> record_bytes;
+        std::vector<unsigned long long> area_totals;
+        unsigned long long total_interface = 0;
+        std::vector<running_stats> area_stats;
+        std::vector<running_stats> interface_stats;
+        std::string snapshot_file;
+        double snapshot_seconds = SNAPSHOT_SECONDS;
+        long long sample_snapshot_steps = 0;
+        int first_sample = 0;
+        std::chrono::steady_clock::time_point last_snapshot;
+        bool walk_lanes = false;
+        // 1D samples run on walk_arcs (see uses_arcs), false steps every move on the torus
+        bool use_arcs = true;
+        // a solo RANDOM_WALK agent jumps out of claimed squares (see walk_jumps)
+        bool jumps = false;
+        // with a visits file 2D samples keep the step every site was claimed at (see measure_visits)
+        std::string visits_file_name;
+        std::ofstream visits_file;
+        int visit_points = VISIT_CURVE_POINTS;
+        running_stats cover_time_stats;
+        // the fractions of the sites whose steps are recorded, with their statistics
+        std::vector<double> coverage_fractions;
+        std::vector<running_stats> coverage_stats;
+        std::vector<uint32_t> visit_steps;
+        // the simulations running lanes 1, 2, ... of simulate_lanes, lane 0 is this one
+        std::vector<simulation *> lane_workers;
+        // where the tori of owned agents come from and go back to, NULL to allocate and delete them
+        torus_pool<torus_type> * pool = NULL;
 
-        simulation_1D_1v1(agent_1D * agent1, agent_1D * agent2, int sample_size, const char * torus_file_name, const char * interface_file_name) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
+        simulation(std::vector<std::vector<agent_type *>> teams, std::vector<int> moves_per_step, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL)) {
+            if (teams.size() < 1 || teams.size() > 2 || moves_per_step.size() != teams.size()) {
+                std::cerr << "a simulation needs one or two teams and the moves per step of each" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->teams = teams;
+            this->moves_per_step = moves_per_step;
+            for (std::vector<agent_type *> & team : teams) {
+                for (agent_type * agent : team) {
+                    this->agents.push_back(agent);
+                }
+            }
+            this->t = this->agents[0]->t;
             this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            srand(time(NULL));
-            torus_file.open(torus_file_name);
-            interface_file.open(interface_file_name);
-            this->interface_size = 0;
+            set_schedule(checkpoint_schedule());
+            this->experiment_id = experiment_id;
+            if (file != NULL) this->output_file_name = file;
+            if (file_sum != NULL) this->output_file_sums_name = file_sum;
         }
 
-        void simulate_sample_size() {
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
+        virtual ~simulation() {
+            for (simulation * lane : this->lane_workers) {
+                delete lane;
+            }
+            if (this->owns_agents) {
+                if (this->pool != NULL) this->pool->release(this->t);
+                else delete this->t;
+                for (agent_type * agent : this->agents) {
+                    delete agent;
+                }
             }
-            torus_file.close();
-            interface_file.close();
         }
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            for (long long i = 0; i < TORUS_SIZE * TORUS_SIZE; i++) {
-                if (rand() % 2 == 0) {
-                    this->agent1->move();
-                    this->agent2->move();
-                } else {
-                    this->agent2->move();
-                    this->agent1->move();
+        // a copy of this simulation on a torus and agents of its own, without output files
+        simulation * make_worker() {
+            torus_type * t = this->pool != NULL ? this->pool->take(this->t->size) : this->t->blank_copy();
+            std::vector<std::vector<agent_type *>> teams;
+            for (std::vector<agent_type *> & team : this->teams) {
+                teams.push_back(std::vector<agent_type *>());
+                for (agent_type * agent : team) {
+                    teams.back().push_back(agent->copy(t));
                 }
             }
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                if (this->agent1->t->grid[i] != (this->agent1->t->grid[(i + 1) % TORUS_SIZE])) {
-                    this->interface_size++;
-                    torus_file << i << " ";
+            simulation * worker = new simulation(teams, this->moves_per_step, this->sample_size, NULL, NULL, this->experiment_id);
+            worker->set_checkpoints(this->checkpoints);
+            worker->pool = this->pool;
+            worker->mine_chance = this->mine_chance;
+            worker->distance = this->distance;
+            worker->measure_interface = this->measure_interface;
+            worker->snapshot_file = this->snapshot_file;
+            worker->sample_snapshot_steps = this->sample_snapshot_steps;
+            worker->walk_lanes = this->walk_lanes;
+            worker->use_arcs = this->use_arcs;
+            worker->jumps = this->jumps;
+            worker->visits_file_name = this->visits_file_name;
+            worker->visit_points = this->visit_points;
+            worker->coverage_fractions = this->coverage_fractions;
+            worker->owns_agents = true;
+            return worker;
+        }
+
+        // lays the checkpoints out as schedule says, before the samples start
+        void set_schedule(const checkpoint_schedule & schedule) {
+            set_checkpoints(checkpoint_steps(schedule, dimension, this->t->size));
+        }
+
+        // in 2D, records the steps at which the agents have claimed each of the fractions of the sites they can reach;
+        // like the visits file this needs the checkpoints to end by VISIT_STEP_MAX
+        void set_coverage_fractions(const std::vector<double> & fractions) {
+            if (dimension != 2) return;
+            this->coverage_fractions = fractions;
+            this->coverage_stats.assign(fractions.size(), running_stats());
+        }
+
+        // replaces the checkpoints, a nonempty list of increasing steps, before the samples start
+        void set_checkpoints(const std::vector<long long> & checkpoints) {
+            this->checkpoints = checkpoints;
+            this->area_totals.assign(this->checkpoints.size() * this->teams.size(), 0);
+            this->area_stats.assign(this->checkpoints.size() * this->teams.size(), running_stats());
+            this->interface_stats.assign(this->checkpoints.size(), running_stats());
+        }
+
+        // the memory a worker needs, a torus for each of its lanes
+        unsigned long long worker_bytes() {
+            return torus_bytes() * lane_count();
+        }
+
+        unsigned long long torus_bytes() {
+            if constexpr (dimension == 1) return this->t->size;
+            if constexpr (dimension == 2) return this->t->grid_bytes() + (tracks_visits() ? sizeof(uint32_t) * torus_sites() : 0);
+            if constexpr (dimension == 3) {
+                // every move claims at most one site
+                unsigned long long moves = 0;
+                for (size_t i = 0; i < this->teams.size(); i++) {
+                    moves += this->teams[i].size() * this->moves_per_step[i];
                 }
+                return torus_3D::max_allocated_bytes(this->t->size, moves * this->checkpoints.back());
             }
-            torus_file << "\n";
-            interface_file << this->interface_size << "\n";
-            this->interface_size = 0;
         }
-};
 
-/* 
- * Simulates one agent in 2 dimensions. 
- */ 
-class simulation_2D {
-    public:
-        agent_2D * agent1 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long area_total[U_LIST_LEN];
+        /*
+         * How many samples simulate_lanes runs at once: WALK_LANES with
+         * walk_lanes for a single 2D agent that step_lanes can step, on a
+         * torus without mines, otherwise 1. Samples saved mid-way run one at
+         * a time as well.
+         */
+        int lane_count() {
+            if constexpr (dimension == 2) {
+                if (!this->walk_lanes || this->agents.size() != 1 || this->mine_chance > 0 || uses_jumps() || tracks_visits()) return 1;
+                if (this->sample_snapshot_steps > 0 || tracks_interface()) return 1;
+                if (step_lanes_fit(this->t, this->agents[0]->strategy)) return WALK_LANES;
+            }
+            return 1;
+        }
 
-        simulation_2D(agent_2D * agent1, int sample_size, const char * file, const char * file_sum) {
-            this->agent1 = agent1;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-                area_total[i] = 0;
+        // whether simulate() runs a 1D sample on walk_arcs, which takes one move per agent and step and no sample snapshots
+        bool uses_arcs() {
+            if (dimension != 1 || !this->use_arcs || this->sample_snapshot_steps > 0) return false;
+            return this->teams.size() == 2 && this->agents.size() == 2 && this->moves_per_step[0] == 1 && this->moves_per_step[1] == 1;
+        }
+
+        // whether simulate() runs a 2D sample on walk_jumps, for a solo RANDOM_WALK agent without mines or sample snapshots
+        bool uses_jumps() {
+            if (dimension != 2 || !this->jumps || this->sample_snapshot_steps > 0 || this->mine_chance > 0 || tracks_visits()) return false;
+            return this->agents.size() == 1 && this->agents[0]->strategy == RANDOM_WALK;
+        }
+
+        unsigned long long torus_sites() {
+            unsigned long long sites = 1;
+            for (int i = 0; i < dimension; i++) {
+                sites *= this->t->size;
             }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
+            return sites;
         }
 
         void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
+            start_output();
+            simulate_samples<simulation, sample_result>(this, sample_size, threads, this->first_sample);
+            finish_output();
+        }
+
+        // opens the output files and writes what comes before the first sample, or resumes from the snapshot
+        void start_output() {
+            if (tracks_visits() && this->checkpoints.back() > VISIT_STEP_MAX) {
+                std::cerr << "visits are only tracked up to step " << VISIT_STEP_MAX << ", not to the last checkpoint " << this->checkpoints.back() << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            this->first_sample = 0;
+            this->last_snapshot = std::chrono::steady_clock::now();
+            if (!this->snapshot_file.empty() && load_run()) {
+                std::cout << "Resuming experiment " << this->experiment_id << " at sample " << this->first_sample << std::endl;
+                output_file.open(this->output_file_name, this->output_format == BINARY_OUTPUT ? std::ios::app | std::ios::binary : std::ios::app);
+                output_file_sums.open(this->output_file_sums_name, std::ios::app);
+                if (!this->visits_file_name.empty()) visits_file.open(this->visits_file_name, std::ios::app);
+                return;
             }
-            output_file << "]";
+            if (!this->visits_file_name.empty()) start_visits();
+            if (this->output_format == BINARY_OUTPUT) {
+                output_file.open(this->output_file_name, std::ios::binary);
+                output_file_sums.open(this->output_file_sums_name);
+                trajectory_header header = trajectory();
+                write_trajectory_header(output_file, header);
+                return;
+            }
+            output_file.open(this->output_file_name);
+            output_file_sums.open(this->output_file_sums_name);
+            if (dimension != 1) output_file << "[";
+        }
+
+        // what the header of the binary output file says about this simulation
+        trajectory_header trajectory() {
+            trajectory_header header;
+            header.scenario = this->scenario;
+            header.dimension = dimension;
+            header.torus_size = this->t->size;
+            header.experiment_id = this->experiment_id;
+            header.sample_size = this->sample_size;
+            if (this->measure_interface) header.flags |= TRAJECTORY_INTERFACE | TRAJECTORY_INTERFACE_SERIES;
+            if (dimension == 1) header.flags |= TRAJECTORY_SITES;
+            header.mine_chance = this->mine_chance;
+            header.distance = this->distance;
+            for (size_t i = 0; i < this->teams.size(); i++) {
+                header.moves_per_step.push_back(this->moves_per_step[i]);
+                header.strategies.push_back(std::vector<unsigned int>());
+                for (agent_type * agent : this->teams[i]) {
+                    header.strategies.back().push_back(agent->strategy);
+                }
+            }
+            header.checkpoints.assign(this->checkpoints.begin(), this->checkpoints.end());
+            return header;
+        }
+
+        // writes what comes after the last sample and closes the output files
+        void finish_output() {
+            if (dimension != 1 && this->output_format == TEXT_OUTPUT) output_file << "]";
             output_file.close();
+            if (dimension != 1) {
+                write_sums();
+                output_file_sums << "\n";
+            }
+            std::vector<statistics_line> lines = statistics();
+            if (dimension != 1) {
+                write_statistics(output_file_sums, lines);
+            } else if (!this->output_file_sums_name.empty()) {
+                // the 1D interface file keeps one count per line, its statistics go next to it
+                std::ofstream statistics_file(this->output_file_sums_name + ".stats");
+                write_statistics(statistics_file, lines);
+            }
+            output_file_sums.close();
+            visits_file.close();
+            if (!this->snapshot_file.empty()) remove(this->snapshot_file.c_str());
+        }
 
+        bool tracks_interface() {
+            return this->measure_interface || dimension == 1;
+        }
+
+        // whether 2D samples keep the step every site was claimed at, for the visits file or the coverage fractions
+        bool tracks_visits() {
+            return dimension == 2 && (!this->visits_file_name.empty() || !this->coverage_fractions.empty());
+        }
+
+        /*
+         * Opens the visits file, whose first line lists the steps of the
+         * coverage curve, "# steps s1 s2 ...", visit_points steps up to the
+         * last checkpoint. record_visits() then adds a line
+         * "cover_time x y a1 a2 ..." per sample: the step the torus was
+         * covered at or -1, the site claimed last and the area after each
+         * step of the curve.
+         */
+        void start_visits() {
+            visits_file.open(this->visits_file_name);
+            visits_file << "# steps";
+            for (int k = 0; k < this->visit_points; k++) {
+                visits_file << " " << curve_step(k);
+            }
+            visits_file << "\n";
+        }
+
+        // the step point k of the coverage curve is taken after
+        long long curve_step(int k) {
+            return this->checkpoints.back() * (k + 1) / this->visit_points;
+        }
+
+        // the area of every team at every checkpoint, and the interface where it is measured
+        std::vector<statistics_line> statistics() {
+            std::vector<statistics_line> lines;
+            int team_count = this->teams.size();
+            for (size_t i = 0; i < this->area_stats.size(); i++) {
+                lines.push_back({"area", this->checkpoints[i / team_count], (int) i % team_count, this->area_stats[i]});
+            }
+            if (tracks_interface()) {
+                for (size_t i = 0; i < this->checkpoints.size(); i++) {
+                    lines.push_back({"interface", this->checkpoints[i], 0, this->interface_stats[i]});
+                }
+            }
+            if (tracks_visits()) lines.push_back({"cover_time", this->checkpoints.back(), 0, this->cover_time_stats});
+            for (size_t i = 0; i < this->coverage_stats.size(); i++) {
+                std::ostringstream name;
+                name << "coverage_" << this->coverage_fractions[i];
+                lines.push_back({name.str(), this->checkpoints.back(), 0, this->coverage_stats[i]});
+            }
+            return lines;
+        }
+
+        // writes the totals over the samples to the sums file
+        void write_sums() {
             output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << area_total[i];
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
+            for (size_t i = 0; i < this->checkpoints.size(); i++) {
+                if (this->teams.size() == 1) {
+                    output_file_sums << this->area_totals[i];
+                } else {
+                    output_file_sums << "[" << this->area_totals[2 * i] << ", " << this->area_totals[2 * i + 1] << "]";
+                }
+                if (i != this->checkpoints.size() - 1) output_file_sums << ", ";
             }
+            if (this->measure_interface) output_file_sums << "(total interface: " << this->total_interface << ")";
             output_file_sums << "]";
-            output_file_sums.close();
         }
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                this->agent1->move();
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    area_total[current_u_list_position] += this->agent1->area_covered;
-                    output_file << this->agent1->area_covered; 
-                    if (i + 1 != scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                    current_u_list_position++;
+        void simulate(int sample, sample_result & result) {
+            rng_stream order(this->experiment_id, sample, ORDER_STREAM);
+            std::vector<rng_stream> rngs;
+            start_sample(sample, rngs, result);
+            step_position position;
+            if (this->sample_snapshot_steps > 0) load_sample(sample, position, order, rngs, result);
+
+            if constexpr (dimension == 1) {
+                if (uses_arcs()) {
+                    walk_arcs(this->agents[0], this->agents[1], rngs[0], rngs[1], order, this->checkpoints, reachable_sites(), [&]() {
+                        record_checkpoint(result);
+                    });
+                    finish_sample(result);
+                    return;
                 }
             }
-            output_file << "]";
+            if constexpr (dimension == 2) {
+                if (uses_jumps()) {
+                    walk_jumps(rngs[0], order, result);
+                    finish_sample(result);
+                    return;
+                }
+            }
+
+            // with one agent, or two solo agents below 3D, the step loop is instantiated for
+            // their strategies; the 81 pairs of 3D strategies would crowd the inliner out of the
+            // 2D loops, and the 3D steps are bound by the torus lookups anyway
+            if (this->agents.size() == 1) {
+                agent_type * agent1 = this->agents[0];
+                rng_stream & rng1 = rngs[0];
+                int moves1 = this->moves_per_step[0];
+                with_strategy<dimension>(agent1->strategy, [&](auto s1) {
+                    auto move = [agent1, &rng1, moves1](int) {
+                        for (int m = 0; m < moves1; m++) agent1->template move<decltype(s1)::value>(rng1);
+                    };
+                    steps(move, sample, position, order, rngs, result);
+                });
+            } else if (dimension != 3 && this->agents.size() == 2 && this->teams.size() == 2) {
+                agent_type * agent1 = this->agents[0];
+                agent_type * agent2 = this->agents[1];
+                rng_stream & rng1 = rngs[0];
+                rng_stream & rng2 = rngs[1];
+                int moves1 = this->moves_per_step[0];
+                int moves2 = this->moves_per_step[1];
+                with_strategy<dimension>(agent1->strategy, [&](auto s1) {
+                    with_strategy<dimension>(agent2->strategy, [&](auto s2) {
+                        auto move = [agent1, agent2, &rng1, &rng2, moves1, moves2](int team) {
+                            if (team == 0) {
+                                for (int m = 0; m < moves1; m++) agent1->template move<decltype(s1)::value>(rng1);
+                            } else {
+                                for (int m = 0; m < moves2; m++) agent2->template move<decltype(s2)::value>(rng2);
+                            }
+                        };
+                        steps(move, sample, position, order, rngs, result);
+                    });
+                });
+            } else {
+                auto move = [&](int team) {
+                    // the agents of a team follow those of the teams before it in agents
+                    int first = team == 0 ? 0 : this->teams[0].size();
+                    for (int k = first; k < first + (int) this->teams[team].size(); k++) {
+                        for (int m = 0; m < this->moves_per_step[team]; m++) {
+                            this->agents[k]->move(rngs[k]);
+                        }
+                    }
+                };
+                steps(move, sample, position, order, rngs, result);
+            }
+            finish_sample(result);
         }
-};
 
-/* 
- * Simulates three agents collaborating in 2 dimensions. 
- */ 
-class simulation_3_collab_2D {
-    public:
-        agent_2D * agent1 = NULL;
-        agent_2D * agent2 = NULL;
-        agent_2D * agent3 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long area_total[U_LIST_LEN];
-
-        simulation_3_collab_2D(agent_2D * agent1, agent_2D * agent2, agent_2D * agent3, int sample_size, const char * file, const char * file_sum) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->agent3 = agent3; 
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-                area_total[i] = 0;
+        // the agents' rng streams and the blank or mined torus and the agents at the start of a sample
+        void start_sample(int sample, std::vector<rng_stream> & rngs, sample_result & result) {
+            rngs.clear();
+            for (agent_type * agent : this->agents) {
+                rngs.push_back(rng_stream(this->experiment_id, sample, agent->id));
+            }
+            if constexpr (dimension != 3) this->t->track_interface = tracks_interface();
+            if constexpr (dimension == 2) {
+                this->t->track_blocks = uses_jumps();
+                this->t->track_visits = tracks_visits();
+            }
+            reset_torus(sample);
+            for (size_t k = 0; k < this->agents.size(); k++) {
+                reset_agent(k, rngs[k]);
             }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
+            result.areas.clear();
+            result.interfaces.clear();
         }
 
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
+        // what is measured on the torus at the end of a sample
+        void finish_sample(sample_result & result) {
+            if constexpr (dimension != 3) result.interface = this->t->interface;
+            if constexpr (dimension == 2) {
+                if (this->t->track_visits) measure_visits(result);
             }
-            output_file << "]";
-            output_file.close();
+            if constexpr (dimension == 1) {
+                int n = this->t->size;
+                result.interface_sites.clear();
+                for (int i = 0; i < n; i++) {
+                    if (this->t->grid[i] != (this->t->grid[(i + 1) % n])) {
+                        result.interface_sites.push_back(i);
+                    }
+                }
+            }
+        }
 
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << area_total[i];
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
+        /*
+         * Runs samples first .. first + count - 1, count at most
+         * lane_count(), into results[0 .. count - 1].
+         *
+         * With a single agent a step is a direction, a dependent load of
+         * the site and a store. Stepping the agents of WALK_LANES samples,
+         * each on a torus of its own, in the lanes of step_lanes does that
+         * for all of them at once. Every lane draws from its sample's own
+         * streams, so the results are those of simulate(); a shorter group
+         * at the end of the samples runs one sample at a time.
+         */
+        void simulate_lanes(int first, int count, std::vector<sample_result> & results) {
+            if constexpr (dimension == 2) {
+                if (count == WALK_LANES) {
+                    lane_samples(first, results);
+                    return;
+                }
+            }
+            for (int k = 0; k < count; k++) {
+                simulate(first + k, results[k]);
             }
-            output_file_sums << "]";
-            output_file_sums.close();
         }
 
-        void simulate() {
-            this->agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            this->agent3->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                this->agent1->move();
-                this->agent2->move();
-                this->agent3->move();
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    area_total[current_u_list_position] += this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered;
-                    output_file << this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered; 
-                    if (i + 1 != scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                    current_u_list_position++;
+        /*
+         * The step loop of simulate_lanes. step_lanes runs until the next
+         * checkpoint or coverage check; a lane that has covered its torus
+         * keeps walking, which claims nothing, until every lane has.
+         */
+        void lane_samples(int first, std::vector<sample_result> & results) {
+            while (this->lane_workers.size() < WALK_LANES - 1) {
+                this->lane_workers.push_back(make_worker());
+            }
+            std::vector<simulation *> lanes(1, this);
+            lanes.insert(lanes.end(), this->lane_workers.begin(), this->lane_workers.begin() + WALK_LANES - 1);
+            agent_type * agents[WALK_LANES];
+            rng_stream rngs[WALK_LANES];
+            unsigned long long sites = reachable_sites();
+            std::vector<rng_stream> lane_rngs;
+            for (int k = 0; k < WALK_LANES; k++) {
+                lanes[k]->start_sample(first + k, lane_rngs, results[k]);
+                agents[k] = lanes[k]->agents[0];
+                rngs[k] = lane_rngs[0];
+            }
+            int moves = this->moves_per_step[0];
+            long long last_step = this->checkpoints.back();
+            size_t current_checkpoint = 0;
+            long long next_checkpoint = this->checkpoints[0];
+            long long next_check = 1;
+            bool covered = false;
+            // step is the number of steps taken so far
+            for (long long step = 0; step < last_step && !covered;) {
+                long long until = std::min(next_check, last_step);
+                if (next_checkpoint > step) until = std::min(until, next_checkpoint);
+                with_strategy<dimension>(agents[0]->strategy, [&](auto s) {
+                    if constexpr (decltype(s)::value == RANDOM_WALK || decltype(s)::value == RANDOM_WALK_NB) {
+                        step_lanes<decltype(s)::value>(agents, rngs, (until - step) * moves);
+                    }
+                });
+                step = until;
+                // as in steps(), after the steps i with i % COVERAGE_CHECK == 0
+                if (step == next_check) {
+                    covered = true;
+                    for (int k = 0; k < WALK_LANES; k++) {
+                        covered = covered && agents[k]->area_covered >= sites;
+                    }
+                    next_check += COVERAGE_CHECK;
+                }
+                if (step == next_checkpoint) {
+                    for (int k = 0; k < WALK_LANES; k++) {
+                        results[k].areas.push_back(agents[k]->area_covered);
+                    }
+                    current_checkpoint++;
+                    if (current_checkpoint < this->checkpoints.size()) next_checkpoint = this->checkpoints[current_checkpoint];
+                }
+            }
+            for (; current_checkpoint < this->checkpoints.size(); current_checkpoint++) {
+                for (int k = 0; k < WALK_LANES; k++) {
+                    results[k].areas.push_back(agents[k]->area_covered);
                 }
             }
-            output_file << "]";
+            for (int k = 0; k < WALK_LANES; k++) {
+                lanes[k]->finish_sample(results[k]);
+            }
         }
-};
 
-/*
- * Simulates a competition between two agents in 2D.
- * 
- * The output file will hold the total areas covered at the specified
- * u values by each agent.  
- */
-class simulation_2D_1v1 {
-    public:
-        agent_2D * agent1 = NULL;
-        agent_2D * agent2 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-        simulation_2D_1v1(agent_2D * agent1, agent_2D * agent2, int sample_size, const char * file, const char * file_sum) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
+        /*
+         * The step loop of a solo RANDOM_WALK agent with jumps. The moves
+         * run through step_segment, as in steps(), in spans of
+         * JUMP_IDLE_MOVES moves that end early at a checkpoint. After a
+         * span without a claim the agent looks for a claimed square around
+         * it, and if there is one jumps out of it with a square_exit drawn
+         * from its stream, which counts the moves in between. Nothing is
+         * claimed inside the square, so the checkpoints among those moves
+         * see the area before the jump and the one after them what the
+         * jump claimed. The samples follow the same distribution as those
+         * of steps(), not the same draws.
+         */
+        void walk_jumps(rng_stream & rng, rng_stream & order, sample_result & result) {
+            agent_type * agent = this->agents[0];
+            const square_exits & exits = square_exits::table();
+            unsigned long long sites = reachable_sites();
+            int n = this->t->size;
+            long long moves_per_step = this->moves_per_step[0];
+            long long last_move = this->checkpoints.back() * moves_per_step;
+            size_t current_checkpoint = 0;
+            auto walk = [agent, &rng](int) {
+                agent->template move<RANDOM_WALK>(rng);
+            };
+            for (long long move = 0; move < last_move && agent->area_covered < sites;) {
+                unsigned long long area = agent->area_covered;
+                long long next_checkpoint = this->checkpoints[current_checkpoint] * moves_per_step;
+                move = step_segment<false>(walk, move, std::min(move + JUMP_IDLE_MOVES, next_checkpoint), 1, order);
+                if (move == next_checkpoint) {
+                    record_checkpoint(result);
+                    current_checkpoint++;
+                }
+                if (move == last_move || agent->area_covered != area || !this->t->covered_square(agent->x, agent->y, JUMP_RADIUS)) continue;
+                square_exit exit = exits.sample(rng);
+                while (current_checkpoint < this->checkpoints.size() && this->checkpoints[current_checkpoint] * moves_per_step < move + exit.moves) {
+                    record_checkpoint(result);
+                    current_checkpoint++;
+                }
+                agent->x = ((agent->x + exit.dx) % n + n) % n;
+                agent->y = ((agent->y + exit.dy) % n + n) % n;
+                if (exit.left) agent->update_torus();
+                move += exit.moves;
+            }
+            for (; current_checkpoint < this->checkpoints.size(); current_checkpoint++) {
+                record_checkpoint(result);
             }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
         }
 
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
+        void reset_torus(int sample) {
+            if constexpr (dimension == 2) {
+                if (this->mine_chance > 0) {
+                    rng_stream mines(this->experiment_id, sample, MINES_STREAM);
+                    this->t->reset_torus_with_mines(this->mine_chance, mines);
+                    return;
+                }
             }
-            output_file << "]";
-            output_file.close();
+            this->t->reset_torus();
+        }
 
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
+        void reset_agent(int k, rng_stream & rng) {
+            if constexpr (dimension == 2) {
+                if (this->distance != -1) {
+                    if (k == 0) this->agents[k]->reset_agent_to_origin();
+                    else this->agents[k]->reset_agent_to_distance_from_origin(this->distance);
+                    return;
+                }
             }
-            output_file_sums << "]";
-            output_file_sums.close();
+            this->agents[k]->reset_agent(rng);
         }
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                if (rand() % 2 == 0) {
-                    this->agent1->move();
-                    this->agent2->move();
-                } else {
-                    this->agent2->move();
-                    this->agent1->move();
+        /*
+         * The step loop of a sample from position on, move(team) moves every
+         * agent of the team for one step. With sample_snapshot_steps the
+         * sample is saved every that many steps. The steps run in segments
+         * that end at the next checkpoint, coverage check or snapshot, so the
+         * inner loop (step_segment) only moves the agents, and only stamps the
+         * clock of the torus as well when visits are tracked.
+         *
+         * Once the agents have claimed every site they can reach no area
+         * changes any more, so the loop stops there and the remaining
+         * checkpoints get the final areas.
+         */
+        // steps i to end - 1, stamping the claims with their step when stamps is set, and returns end
+        template <bool stamps, class Mover>
+        long long step_segment(Mover & move, long long i, long long end, int team_count, rng_stream & order) {
+            for (; i < end; i++) {
+                // the step the sites claimed in this step are stamped with, which fits as the checkpoints end by VISIT_STEP_MAX
+                if constexpr (stamps && dimension == 2) this->t->clock = (uint32_t) (i + 1);
+                // with two teams a coin decides which one moves first
+                int first = team_count == 2 && !order.coin();
+                for (int k = 0; k < team_count; k++) {
+                    move(first ^ k);
                 }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->agent1->area_covered;
-                    unsigned long long team2_area_covered = this->agent2->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << this->agent1->area_covered << ", "; 
-                    output_file << this->agent2->area_covered << "]";
-                    if (i + 1 != this->scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                    current_u_list_position++;
+            }
+            return end;
+        }
+
+        template <class Mover>
+        void steps(Mover & move, int sample, step_position & position, rng_stream & order, std::vector<rng_stream> & rngs, sample_result & result) {
+            unsigned long long sites = reachable_sites();
+            int team_count = this->teams.size();
+            long long last_step = this->checkpoints.back();
+            size_t current_checkpoint = position.checkpoint;
+            long long next_checkpoint = current_checkpoint < this->checkpoints.size() ? this->checkpoints[current_checkpoint] : last_step;
+            long long next_snapshot = this->sample_snapshot_steps > 0 ? position.step + this->sample_snapshot_steps : -1;
+            bool covered = position.covered;
+            bool stamps = tracks_visits();
+            long long i = position.step;
+            while (i < last_step && !covered) {
+                if (i == next_snapshot) {
+                    position.step = i;
+                    position.checkpoint = current_checkpoint;
+                    position.covered = covered;
+                    save_sample(sample, position, order, rngs, result);
+                    next_snapshot += this->sample_snapshot_steps;
                 }
+                // the steps up to the next checkpoint, coverage check or snapshot, which run without testing for them
+                long long check = (i + COVERAGE_CHECK - 1) / COVERAGE_CHECK * COVERAGE_CHECK;
+                long long end = std::min(std::min(last_step, next_checkpoint), check + 1);
+                if (next_snapshot > i) end = std::min(end, next_snapshot);
+                if (stamps) i = step_segment<true>(move, i, end, team_count, order);
+                else i = step_segment<false>(move, i, end, team_count, order);
+                // moves on a fully covered torus claim nothing, so checking after every COVERAGE_CHECK-th step is enough
+                if (i - 1 == check) covered = area_covered() >= sites;
+                if (i == next_checkpoint && current_checkpoint < this->checkpoints.size()) {
+                    record_checkpoint(result);
+                    current_checkpoint++;
+                    if (current_checkpoint < this->checkpoints.size()) next_checkpoint = this->checkpoints[current_checkpoint];
+                }
+            }
+            for (; current_checkpoint < this->checkpoints.size(); current_checkpoint++) {
+                record_checkpoint(result);
             }
-            output_file << "]";
         }
-};
 
-/*
- * Simulates a competition between two agents in 2D and calculates their interface.
- * 
- * The output file will hold the total areas covered at the specified
- * u values by each agent.  
- */
-class simulation_2D_1v1_interface {
-    public:
-        agent_2D * agent1 = NULL;
-        agent_2D * agent2 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-        unsigned long long total_interface;
-        int distance;
-
-        simulation_2D_1v1_interface(agent_2D * agent1, agent_2D * agent2, int sample_size, const char * file, const char * file_sum, int distance) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
-            }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
-            this->total_interface = 0;
-            this->distance = distance;
+        /*
+         * The cover time, the site claimed last and the coverage curve of a
+         * sample from the first_visit grid, in one pass: point k of the curve
+         * counts the sites claimed by curve_step(k). The torus is covered once
+         * the agents have claimed every site they can reach.
+         */
+        void measure_visits(sample_result & result) {
+            long long last_step = this->checkpoints.back();
+            int points = this->visit_points;
+            result.curve.assign(points, 0);
+            uint32_t latest = 0;
+            long long latest_site = -1;
+            unsigned long long claimed = 0;
+            this->t->each_visit([&](size_t site, uint32_t stamp) {
+                uint32_t step = stamp - 1;
+                claimed++;
+                if (step > latest || latest_site < 0) {
+                    latest = step;
+                    latest_site = site;
+                }
+                // the first point k with step <= curve_step(k)
+                long long k = ((unsigned long long) step * points + last_step - 1) / last_step - 1;
+                result.curve[std::max(0LL, std::min(k, (long long) points - 1))]++;
+            });
+            for (int k = 1; k < points; k++) {
+                result.curve[k] += result.curve[k - 1];
+            }
+            result.cover_time = claimed >= reachable_sites() ? (long long) latest : -1;
+            result.last_site = latest_site;
+            if (!this->coverage_fractions.empty()) measure_coverage(result, claimed);
         }
 
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
+        // the steps at which the sample reached the coverage fractions, the k-th smallest steps of first_visit
+        void measure_coverage(sample_result & result, unsigned long long claimed) {
+            std::vector<uint32_t> & steps = this->visit_steps;
+            steps.clear();
+            this->t->each_visit([&](size_t, uint32_t stamp) {
+                steps.push_back(stamp - 1);
+            });
+            unsigned long long sites = reachable_sites();
+            result.coverage_steps.clear();
+            for (double fraction : this->coverage_fractions) {
+                unsigned long long k = std::max(1ULL, (unsigned long long) ceil(fraction * sites));
+                if (k > claimed) {
+                    result.coverage_steps.push_back(-1);
+                    continue;
+                }
+                std::nth_element(steps.begin(), steps.begin() + (k - 1), steps.end());
+                result.coverage_steps.push_back(steps[k - 1]);
             }
-            output_file << "]";
-            output_file.close();
+        }
 
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
+        // adds a sample to the cover time and coverage statistics and its line to the visits file (see start_visits)
+        void record_visits(sample_result & result) {
+            if (result.cover_time >= 0) this->cover_time_stats.add(result.cover_time);
+            for (size_t i = 0; i < result.coverage_steps.size(); i++) {
+                if (result.coverage_steps[i] >= 0) this->coverage_stats[i].add(result.coverage_steps[i]);
             }
-            output_file_sums << "(total interface: " << this->total_interface << ")";
-            output_file_sums << "]";
-            output_file_sums.close();
+            if (this->visits_file_name.empty()) return;
+            int n = this->t->size;
+            visits_file << result.cover_time << " ";
+            if (result.last_site < 0) visits_file << "-1 -1";
+            else visits_file << result.last_site / n << " " << result.last_site % n;
+            for (unsigned long long area : result.curve) {
+                visits_file << " " << area;
+            }
+            visits_file << "\n";
         }
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->agent1->reset_agent_to_origin();
-            this->agent2->reset_agent_to_distance_from_origin(this->distance);
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                if (rand() % 2 == 0) {
-                    this->agent1->move();
-                    this->agent2->move();
-                } else {
-                    this->agent2->move();
-                    this->agent1->move();
+        // the area of every team, and the interface when it is tracked, at a checkpoint
+        void record_checkpoint(sample_result & result) {
+            for (size_t team = 0; team < this->teams.size(); team++) {
+                result.areas.push_back(team_area_covered(team));
+            }
+            if constexpr (dimension != 3) {
+                if (this->t->track_interface) result.interfaces.push_back(this->t->interface);
+            }
+        }
+
+        /*
+         * The sites the agents can claim: every site, except in 2D with
+         * mines, where it is the sites connected to an agent without
+         * crossing a mine.
+         */
+        unsigned long long reachable_sites() {
+            if constexpr (dimension == 2) {
+                if (this->mine_chance > 0) return unmined_component_sites();
+            }
+            return torus_sites();
+        }
+
+        /*
+         * Counts the sites of the components of the unmined sites the agents
+         * are in with a scanline flood fill. An agent that starts on a mine
+         * can only step off it, so its neighbours are the seeds instead.
+         */
+        unsigned long long unmined_component_sites() {
+            torus_type * t = this->t;
+            int n = t->size;
+            std::vector<bool> seen((size_t) n * n, false);
+            auto open = [&](int x, int y) {
+                return !seen[(size_t) x * n + y] && t->get(x, y) != MINE;
+            };
+            std::vector<std::pair<int, int>> seeds;
+            for (agent_type * agent : this->agents) {
+                if (t->get(agent->x, agent->y) != MINE) {
+                    seeds.push_back({agent->x, agent->y});
+                    continue;
                 }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->agent1->area_covered;
-                    unsigned long long team2_area_covered = this->agent2->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << this->agent1->area_covered << ", "; 
-                    output_file << this->agent2->area_covered << "]";
-                    if (i + 1 != this->scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                    current_u_list_position++;
+                seeds.push_back({t->wrap(agent->x + 1), agent->y});
+                seeds.push_back({t->wrap(agent->x - 1), agent->y});
+                seeds.push_back({agent->x, t->wrap(agent->y + 1)});
+                seeds.push_back({agent->x, t->wrap(agent->y - 1)});
+            }
+            unsigned long long sites = 0;
+            while (!seeds.empty()) {
+                int x = seeds.back().first;
+                int y = seeds.back().second;
+                seeds.pop_back();
+                if (!open(x, y)) continue;
+                // the run of open sites along y through (x, y), from first on
+                int first = y;
+                int length = 1;
+                seen[(size_t) x * n + y] = true;
+                while (open(x, t->wrap(first - 1))) {
+                    first = t->wrap(first - 1);
+                    seen[(size_t) x * n + first] = true;
+                    length++;
+                }
+                while (open(x, t->wrap(first + length))) {
+                    seen[(size_t) x * n + t->wrap(first + length)] = true;
+                    length++;
+                }
+                sites += length;
+                // one seed for every run of open sites next to it in the rows above and below
+                for (int row : {t->wrap(x + 1), t->wrap(x - 1)}) {
+                    bool in_run = false;
+                    for (int j = 0; j < length; j++) {
+                        int y = t->wrap(first + j);
+                        bool is_open = open(row, y);
+                        if (is_open && !in_run) seeds.push_back({row, y});
+                        in_run = is_open;
+                    }
                 }
             }
-            long interface = this->calculate_interface();
-            this->total_interface += interface;
-            output_file << "(interface: " << interface << ")";
-            output_file << "]";
+            return sites;
         }
 
-        long calculate_interface() {
-            long interface = 0;
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    if (this->agent1->t->grid[i][j] == 1) { // torus[i, j] claimed by agent 1
-                        if (this->agent1->t->grid[(i + 1) % TORUS_SIZE][j] == 2) {
-                            interface++;
-                        }
-                        if (this->agent1->t->grid[i][(j + 1) % TORUS_SIZE] == 2) {
-                            interface++;
-                        }
-                    }
-                    if (this->agent1->t->grid[i][j] == 2) { // torus[i, j] claimed by agent 1
-                        if (this->agent1->t->grid[(i + 1) % TORUS_SIZE][j] == 1) {
-                            interface++;
-                        }
-                        if (this->agent1->t->grid[i][(j + 1) % TORUS_SIZE] == 1) {
-                            interface++;
-                        }
-                    }
+        unsigned long long team_area_covered(int team) {
+            unsigned long long area = 0;
+            for (agent_type * agent : this->teams[team]) {
+                area += agent->area_covered;
+            }
+            return area;
+        }
+
+        unsigned long long area_covered() {
+            unsigned long long area = 0;
+            for (agent_type * agent : this->agents) {
+                area += agent->area_covered;
+            }
+            return area;
+        }
+
+        void record(int sample, sample_result & result) {
+            for (size_t i = 0; i < result.areas.size(); i++) {
+                this->area_totals[i] += result.areas[i];
+                this->area_stats[i].add(result.areas[i]);
+            }
+            for (size_t i = 0; i < result.interfaces.size(); i++) {
+                this->interface_stats[i].add(result.interfaces[i]);
+            }
+            if (this->measure_interface) this->total_interface += result.interface;
+            if (tracks_visits()) record_visits(result);
+            if (dimension == 1) {
+                output_file_sums << result.interface_sites.size() << "\n";
+            }
+            // without an output file only the sums and statistics are kept
+            if (!output_file.is_open()) {
+            } else if (this->output_format == BINARY_OUTPUT) {
+                record_binary(result);
+            } else if (dimension == 1) {
+                for (int site : result.interface_sites) {
+                    output_file << site << " ";
                 }
+                output_file << "\n";
+            } else {
+                output_file << "[";
+                write_checkpoints(output_file, result.areas, this->teams.size());
+                if (this->measure_interface) output_file << "(interface: " << result.interface << ")";
+                output_file << "]";
+                if (sample != sample_size - 1) output_file << ", ";
+            }
+
+            if (this->snapshot_file.empty()) return;
+            if (this->sample_snapshot_steps > 0) remove(sample_snapshot_file(sample).c_str());
+            std::chrono::duration<double> since = std::chrono::steady_clock::now() - this->last_snapshot;
+            if (sample + 1 < this->sample_size && since.count() >= this->snapshot_seconds) {
+                save_run(sample + 1);
+                this->last_snapshot = std::chrono::steady_clock::now();
             }
-            return interface;
         }
-};
 
-/*
- * Simulates a competition between two teams of agents in 2D.
- * 
- * The first team is a solo agent.
- * The second team is 3 different agents.
- * 
- * The solo agent will move three times for every one move of the second team. 
- * 
- * The output file will hold the total areas covered at the specified
- * u values by each agent.  
- */
-class simulation_2D_1v3 {
-    public:
-        agent_2D * solo_agent = NULL;
-        agent_2D * agent1 = NULL;
-        agent_2D * agent2 = NULL;
-        agent_2D * agent3 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-        simulation_2D_1v3(agent_2D * solo_agent, agent_2D * agent1, agent_2D * agent2, agent_2D * agent3, int sample_size, const char * file, const char * file_sum) {
-            this->solo_agent = solo_agent;
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->agent3 = agent3;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
+        /*
+         * Saves the samples recorded so far to snapshot_file: the totals and
+         * statistics, the sample to go on with and where the output files
+         * end. Each sample draws from its own rng streams, so the sample
+         * index is all the rng state there is between samples.
+         */
+        void save_run(int next_sample) {
+            output_file.flush();
+            output_file_sums.flush();
+            visits_file.flush();
+            sync_file(this->output_file_name);
+            sync_file(this->output_file_sums_name);
+            if (!this->visits_file_name.empty()) sync_file(this->visits_file_name);
+            std::ostringstream out;
+            out.write(run_snapshot_magic, 8);
+            save_run_key(out);
+            save_value(out, this->experiment_id);
+            save_value(out, next_sample);
+            save_value(out, (long long) output_file.tellp());
+            save_value(out, (long long) output_file_sums.tellp());
+            save_value(out, (long long) (!this->visits_file_name.empty() ? (long long) visits_file.tellp() : -1));
+            save_vector(out, this->area_totals);
+            save_value(out, this->total_interface);
+            std::ostringstream stats;
+            std::vector<statistics_line> lines = statistics();
+            write_statistics(stats, lines);
+            save_string(out, stats.str());
+            if (!replace_file(this->snapshot_file, out.str())) {
+                std::cerr << "could not write the snapshot " << this->snapshot_file << std::endl;
             }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
         }
 
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
+        // what a snapshot has to agree on with the simulation resuming from it
+        void save_run_key(std::ostream & out) {
+            save_string(out, this->scenario);
+            save_value(out, this->t->size);
+            save_value(out, this->sample_size);
+            save_value(out, this->output_format);
+            save_value(out, (unsigned long long) this->teams.size());
+            save_vector(out, this->checkpoints);
+        }
+
+        /*
+         * Restores the samples recorded before the run was interrupted from
+         * snapshot_file and cuts the output files back to where they ended.
+         * False, starting over, if there is no snapshot for this simulation or
+         * its output files are no longer there to cut back.
+         */
+        bool load_run() {
+            std::ifstream in(this->snapshot_file, std::ios::binary);
+            if (!in) return false;
+            std::ostringstream key;
+            save_run_key(key);
+            char magic[8];
+            std::string saved_key(key.str().size(), ' ');
+            in.read(magic, 8);
+            in.read(&saved_key[0], saved_key.size());
+            if (!in || memcmp(magic, run_snapshot_magic, 8) != 0 || saved_key != key.str()) {
+                std::cerr << this->snapshot_file << " is not a snapshot of this simulation, starting over" << std::endl;
+                return false;
             }
-            output_file << "]";
-            output_file.close();
+            unsigned long long experiment_id = 0;
+            int next_sample = 0;
+            long long output_end = -1, sums_end = -1, visits_end = -1;
+            std::vector<unsigned long long> area_totals;
+            unsigned long long total_interface = 0;
+            std::string stats;
+            load_value(in, experiment_id);
+            load_value(in, next_sample);
+            load_value(in, output_end);
+            load_value(in, sums_end);
+            load_value(in, visits_end);
+            load_vector(in, area_totals);
+            load_value(in, total_interface);
+            load_string(in, stats);
+            std::istringstream stats_in(stats);
+            std::vector<statistics_line> lines;
+            if (!in || area_totals.size() != this->area_totals.size() || !read_statistics(stats_in, lines) || lines.size() != statistics().size()) {
+                std::cerr << this->snapshot_file << " is damaged, starting over" << std::endl;
+                return false;
+            }
+            // nothing is restored unless every output file can be cut back, otherwise the run starts over in fresh files
+            if (!cut_file(this->output_file_name, output_end) || !cut_file(this->output_file_sums_name, sums_end) || !cut_file(this->visits_file_name, visits_end)) {
+                std::cerr << "the output files of " << this->snapshot_file << " are missing or too short, starting over" << std::endl;
+                return false;
+            }
+            this->experiment_id = experiment_id;
+            this->first_sample = next_sample;
+            this->area_totals = area_totals;
+            this->total_interface = total_interface;
+            // the area and interface lines come first, the coverage lines last (see statistics())
+            size_t coverage_start = lines.size() - this->coverage_stats.size();
+            for (size_t i = 0; i < lines.size(); i++) {
+                if (i < this->area_stats.size()) this->area_stats[i] = lines[i].stats;
+                else if (lines[i].name == "interface") this->interface_stats[i - this->area_stats.size()] = lines[i].stats;
+                else if (i >= coverage_start) this->coverage_stats[i - coverage_start] = lines[i].stats;
+                else this->cover_time_stats = lines[i].stats;
+            }
+            return true;
+        }
 
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
+        std::string sample_snapshot_file(int sample) {
+            return this->snapshot_file + ".sample" + std::to_string(sample);
+        }
+
+        // saves the torus, the agents, the rng streams and the step of a running sample
+        void save_sample(int sample, step_position & position, rng_stream & order, std::vector<rng_stream> & rngs, sample_result & result) {
+            std::ostringstream out;
+            out.write(sample_snapshot_magic, 8);
+            save_value(out, this->experiment_id);
+            save_value(out, sample);
+            save_value(out, position);
+            save_vector(out, result.areas);
+            save_vector(out, result.interfaces);
+            order.save(out);
+            for (rng_stream & rng : rngs) {
+                rng.save(out);
             }
-            output_file_sums << "]";
-            output_file_sums.close();
+            this->t->save(out);
+            for (agent_type * agent : this->agents) {
+                agent->save(out);
+            }
+            replace_file(sample_snapshot_file(sample), out.str());
         }
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->solo_agent->reset_agent();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            this->agent3->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                if (rand() % 2 == 0) {
-                    this->solo_agent->move();
-                    this->solo_agent->move();
-                    this->solo_agent->move();
-                    this->agent1->move();
-                    this->agent2->move();
-                    this->agent3->move();
-                } else {
-                    this->agent1->move();
-                    this->agent2->move();
-                    this->agent3->move();
-                    this->solo_agent->move();
-                    this->solo_agent->move();
-                    this->solo_agent->move();
+        // continues a sample from its snapshot if there is one, otherwise it starts from the reset torus and agents
+        void load_sample(int sample, step_position & position, rng_stream & order, std::vector<rng_stream> & rngs, sample_result & result) {
+            std::ifstream in(sample_snapshot_file(sample), std::ios::binary);
+            if (!in) return;
+            char magic[8];
+            unsigned long long experiment_id = 0;
+            int saved_sample = -1;
+            in.read(magic, 8);
+            load_value(in, experiment_id);
+            load_value(in, saved_sample);
+            if (!in || memcmp(magic, sample_snapshot_magic, 8) != 0 || experiment_id != this->experiment_id || saved_sample != sample) return;
+            load_value(in, position);
+            load_vector(in, result.areas);
+            load_vector(in, result.interfaces);
+            order.load(in);
+            for (rng_stream & rng : rngs) {
+                rng.load(in);
+            }
+            this->t->load(in);
+            for (agent_type * agent : this->agents) {
+                agent->load(in);
+            }
+            if (in) return;
+            std::cerr << sample_snapshot_file(sample) << " is damaged, running sample " << sample << " from the start" << std::endl;
+            position = step_position();
+            result.areas.clear();
+            result.interfaces.clear();
+            order = rng_stream(this->experiment_id, sample, ORDER_STREAM);
+            for (size_t k = 0; k < this->agents.size(); k++) {
+                rngs[k] = rng_stream(this->experiment_id, sample, this->agents[k]->id);
+            }
+            reset_torus(sample);
+            for (size_t k = 0; k < this->agents.size(); k++) {
+                reset_agent(k, rngs[k]);
+            }
+        }
+
+        // writes the record of a sample to the binary output file
+        void record_binary(sample_result & result) {
+            this->record_bytes.clear();
+            for (unsigned long long area : result.areas) {
+                put_u64(this->record_bytes, area);
+            }
+            if (this->measure_interface) {
+                for (long interface : result.interfaces) {
+                    put_u64(this->record_bytes, (uint64_t) (long long) interface);
                 }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->solo_agent->area_covered;
-                    unsigned long long team2_area_covered = this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << team1_area_covered << ", "; 
-                    output_file << team2_area_covered << "]";
-                    if (i + 1 != scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                    current_u_list_position++;
+            }
+            if (dimension == 1) {
+                put_u64(this->record_bytes, result.interface_sites.size());
+                for (int site : result.interface_sites) {
+                    put_u64(this->record_bytes, site);
                 }
             }
-            output_file << "]";
+            output_file.write((const char *) this->record_bytes.data(), this->record_bytes.size());
         }
 };
 
-/* 
- * Simulates a walk of a single agent in 2D on a torus with mines.
- * 
- * The output file will hold the total areas covered at the specified
- * u values by the agent.
+/*
+ * Simulates a competition between two agents in 1D.
+ *
+ * The torus file holds the sites where the territories of the agents meet
+ * and the interface file their number, one line per sample. The statistics
+ * go to the interface file name with .stats appended.
  */
-class simulation_2D_solo_mines {
+class simulation_1D_1v1 : public simulation<1> {
     public:
-        agent_2D * agent = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        double mine_chance = 0.01; 
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long area_total[U_LIST_LEN];
-        
-        simulation_2D_solo_mines(agent_2D * agent, double mine_chance, int sample_size, const char * file, const char * file_sum) {
-        this->agent = agent;
-        this->mine_chance = mine_chance;
-        this->sample_size = sample_size;
-        double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-        for (int i = 0; i < U_LIST_LEN; i++) {
-            scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-            this->area_total[i] = 0;
-        }
-        srand(time(NULL));
-        output_file.open(file);
-        output_file_sums.open(file_sum);
-    }
-
-    void simulate_sample_size() {
-        output_file << "[";
-        for (int i = 0; i < sample_size; i++) {
-            simulate();
-            if (i != sample_size - 1) output_file << ", ";
-        }
-        output_file << "]";
-        output_file.close();
-
-        output_file_sums << "[";
-        for (int i = 0; i < U_LIST_LEN; i++) {
-            output_file_sums << area_total[i];
-            if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
-        }
-        output_file_sums << "]";
-        output_file_sums.close();
-    }
-
-    void simulate() {
-        agent->t->reset_torus_with_mines(this->mine_chance);
-        this->agent->reset_agent();
-        int current_u_list_position = 0;
-        output_file << "[";
-        for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-            this->agent->move();
-            if (i + 1 == scaled_u_list[current_u_list_position]) {
-                this->area_total[current_u_list_position] += this->agent->area_covered;
-                output_file << this->agent->area_covered; 
-                if (i != scaled_u_list[U_LIST_LEN - 1] - 1) output_file << ", ";
-                current_u_list_position++;
-            }
-        }
-        output_file << "]";
-    }
+        simulation_1D_1v1(agent_1D * agent1, agent_1D * agent2, int sample_size, const char * torus_file_name, const char * interface_file_name, unsigned long long experiment_id = time(NULL))
+            : simulation<1>({{agent1}, {agent2}}, {1, 1}, sample_size, torus_file_name, interface_file_name, experiment_id) {
+            this->scenario = "1D_1v1";
+        }
 };
 
-/* 
- * Simulates a competition between two agents in 2D on a torus with mines.
- * 
+/*
+ * Simulates one agent in 2 dimensions.
+ */
+class simulation_2D : public simulation<2> {
+    public:
+        simulation_2D(agent_2D * agent1, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent1}}, {1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D";
+        }
+};
+
+/*
+ * Simulates three agents collaborating in 2 dimensions.
+ */
+class simulation_3_collab_2D : public simulation<2> {
+    public:
+        simulation_3_collab_2D(agent_2D * agent1, agent_2D * agent2, agent_2D * agent3, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent1, agent2, agent3}}, {1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "3_collab_2D";
+        }
+};
+
+/*
+ * Simulates a competition between two agents in 2D.
+ *
  * The output file will hold the total areas covered at the specified
  * u values by each agent.
  */
-class simulation_2D_1v1_mines {
+class simulation_2D_1v1 : public simulation<2> {
     public:
-        agent_2D * agent1 = NULL;
-        agent_2D * agent2 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        double mine_chance = 0.01; 
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-    simulation_2D_1v1_mines(agent_2D * agent1, agent_2D * agent2, double mine_chance, int sample_size, const char * file, const char * file_sum) {
-        this->agent1 = agent1;
-        this->agent2 = agent2;
-        this->mine_chance = mine_chance;
-        this->sample_size = sample_size;
-        double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-        for (int i = 0; i < U_LIST_LEN; i++) {
-            scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * log(TORUS_SIZE));
-            team1_area_total[i] = 0;
-            team2_area_total[i] = 0;
-        }
-        srand(time(NULL));
-        output_file.open(file);
-        output_file_sums.open(file_sum);
-    }
-
-    void simulate_sample_size() {
-        output_file << "[";
-        for (int i = 0; i < sample_size; i++) {
-            simulate();
-            if (i != sample_size - 1) output_file << ", ";
-        }
-        output_file << "]";
-        output_file.close();
-
-        output_file_sums << "[";
-        for (int i = 0; i < U_LIST_LEN; i++) {
-            output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-            if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
-        }
-        output_file_sums << "]";
-        output_file_sums.close();
-    }
-
-    void simulate() {
-        agent1->t->reset_torus_with_mines(this->mine_chance);
-        this->agent1->reset_agent();
-        this->agent2->reset_agent();
-        int current_u_list_position = 0;
-        output_file << "[";
-        for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-            if (rand() % 2 == 0) {
-                this->agent1->move();
-                this->agent2->move();
-            } else {
-                this->agent2->move();
-                this->agent1->move();
-            }
-            if (i + 1 == scaled_u_list[current_u_list_position]) {
-                unsigned long long team1_area_covered = this->agent1->area_covered;
-                unsigned long long team2_area_covered = this->agent2->area_covered;
-                team1_area_total[current_u_list_position] += team1_area_covered;
-                team2_area_total[current_u_list_position] += team2_area_covered; 
-                output_file << "[" << this->agent1->area_covered << ", "; 
-                output_file << this->agent2->area_covered << "]";
-                if (i + 1 != scaled_u_list[U_LIST_LEN - 1]) output_file << ", ";
-                current_u_list_position++;
-            }
-        }
-        output_file << "]";
-    }
+        simulation_2D_1v1(agent_2D * agent1, agent_2D * agent2, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent1}, {agent2}}, {1, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D_1v1";
+        }
 };
 
 /*
- * Simulates a competition between two agents in 3D.
- * 
+ * Simulates a competition between two agents in 2D and calculates their interface.
+ *
+ * The agents start distance apart. The output file will hold the total
+ * areas covered at the specified u values by each agent.
+ */
+class simulation_2D_1v1_interface : public simulation<2> {
+    public:
+        simulation_2D_1v1_interface(agent_2D * agent1, agent_2D * agent2, int sample_size, const char * file, const char * file_sum, int distance, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent1}, {agent2}}, {1, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D_1v1_interface";
+            this->distance = distance;
+            this->measure_interface = true;
+        }
+};
+
+/*
+ * Simulates a competition between two teams of agents in 2D.
+ *
+ * The first team is a solo agent.
+ * The second team is 3 different agents.
+ *
+ * The solo agent will move three times for every one move of the second team.
+ *
  * The output file will hold the total areas covered at the specified
- * u values by each agent.  
+ * u values by each agent.
  */
-class simulation_3D_1v1 {
+class simulation_2D_1v3 : public simulation<2> {
     public:
-        agent_3D * agent1 = NULL;
-        agent_3D * agent2 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file; 
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-        simulation_3D_1v1(agent_3D * agent1, agent_3D * agent2, int sample_size, const char * file, const char * file_sum) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE);
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
-            }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
+        simulation_2D_1v3(agent_2D * solo_agent, agent_2D * agent1, agent_2D * agent2, agent_2D * agent3, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{solo_agent}, {agent1, agent2, agent3}}, {3, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D_1v3";
         }
+};
 
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
-            }
-            output_file << "]";
-            output_file.close();
+/*
+ * Simulates a walk of a single agent in 2D on a torus with mines.
+ *
+ * The output file will hold the total areas covered at the specified
+ * u values by the agent.
+ */
+class simulation_2D_solo_mines : public simulation<2> {
+    public:
+        simulation_2D_solo_mines(agent_2D * agent, double mine_chance, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent}}, {1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D_solo_mines";
+            this->mine_chance = mine_chance;
+        }
+};
 
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
-            }
-            output_file_sums << "]";
-            output_file_sums.close();
+/*
+ * Simulates a competition between two agents in 2D on a torus with mines.
+ *
+ * The output file will hold the total areas covered at the specified
+ * u values by each agent.
+ */
+class simulation_2D_1v1_mines : public simulation<2> {
+    public:
+        simulation_2D_1v1_mines(agent_2D * agent1, agent_2D * agent2, double mine_chance, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<2>({{agent1}, {agent2}}, {1, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "2D_1v1_mines";
+            this->mine_chance = mine_chance;
         }
+};
 
-        void simulate() {
-            agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                if (rand() % 2 == 0) {
-                    this->agent1->move(i);
-                    this->agent2->move();
-                } else {
-                    this->agent2->move();
-                    this->agent1->move(i);
-                }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->agent1->area_covered;
-                    unsigned long long team2_area_covered = this->agent2->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << this->agent1->area_covered << ", "; 
-                    output_file << this->agent2->area_covered << "]";
-                    if (i != (long long) (U_LIST_MAX) * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE - 1) output_file << ", ";
-                    current_u_list_position++;
-                }
-            }
-            output_file << "]";
+/*
+ * Simulates a competition between two agents in 3D.
+ *
+ * The output file will hold the total areas covered at the specified
+ * u values by each agent.
+ */
+class simulation_3D_1v1 : public simulation<3> {
+    public:
+        simulation_3D_1v1(agent_3D * agent1, agent_3D * agent2, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<3>({{agent1}, {agent2}}, {1, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "3D_1v1";
         }
 };
 
 /*
  * Simulates two teams of three agents competing with each other in 3D.
- * 
+ *
  * agent1, agent2, and agent3 are Team 1
  * agent4, agent5, and agent6 are Team 2
- * 
+ *
  * The output file will hold the total areas covered at the specified
  * u values by Team 1 and Team 2
  */
-class simulation_3D_3v3 {
+class simulation_3D_3v3 : public simulation<3> {
     public:
-        agent_3D * agent1 = NULL;
-        agent_3D * agent2 = NULL;
-        agent_3D * agent3 = NULL;
-        agent_3D * agent4 = NULL;
-        agent_3D * agent5 = NULL;
-        agent_3D * agent6 = NULL;
-        long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file;
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-        simulation_3D_3v3(agent_3D * agent1, agent_3D * agent2, agent_3D * agent3, 
-                          agent_3D * agent4, agent_3D * agent5, agent_3D * agent6, 
-                          int sample_size, const char * file, const char * file_sum) {
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->agent3 = agent3;
-            this->agent4 = agent4;
-            this->agent5 = agent5;
-            this->agent6 = agent6;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE);
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
-            }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
-        }
-
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
-            }
-            output_file << "]";
-            output_file.close();
-
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
-            }
-            output_file_sums << "]";
-            output_file_sums.close();
-        }
-
-        void simulate() {
-            this->agent1->t->reset_torus();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            this->agent3->reset_agent();
-            this->agent4->reset_agent();
-            this->agent5->reset_agent();
-            this->agent6->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                unsigned long long total_area_covered = this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered +
-                                                        this->agent4->area_covered + this->agent5->area_covered + this->agent6->area_covered;
-                if (total_area_covered < TORUS_SIZE * TORUS_SIZE * TORUS_SIZE) {
-                    if (rand() % 2 == 0) {
-                        this->agent1->move();
-                        this->agent2->move();
-                        this->agent3->move();
-                        this->agent4->move();
-                        this->agent5->move();
-                        this->agent6->move();
-                    } else {
-                        this->agent4->move();
-                        this->agent5->move();
-                        this->agent6->move();
-                        this->agent1->move();
-                        this->agent2->move();
-                        this->agent3->move();
-                    }
-                }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered;
-                    unsigned long long team2_area_covered = this->agent4->area_covered + this->agent5->area_covered + this->agent6->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << team1_area_covered << ", " << team2_area_covered << "]";
-                    if (i != (long long) (U_LIST_MAX) * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE - 1) output_file << ", ";
-                    current_u_list_position++;
-                }
-            }
-            output_file << "]";
+        simulation_3D_3v3(agent_3D * agent1, agent_3D * agent2, agent_3D * agent3,
+                          agent_3D * agent4, agent_3D * agent5, agent_3D * agent6,
+                          int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<3>({{agent1, agent2, agent3}, {agent4, agent5, agent6}}, {1, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "3D_3v3";
         }
 };
 
@@ -822,100 +1288,17 @@ class simulation_3D_3v3 {
  *
  * solo_agent is Team 1
  * agent1, agent2, and agent3 are Team 2
- * 
+ *
  * Every time step, the solo agent moves three times and each member of Team 2 moves once.
- * 
+ *
  * The output file will hold the total areas covered at the specified
  * u values by Team 1 and Team 2
  */
-class simulation_3D_1v3 {
+class simulation_3D_1v3 : public simulation<3> {
     public:
-        agent_3D * solo_agent = NULL;
-        agent_3D * agent1 = NULL;
-        agent_3D * agent2 = NULL;
-        agent_3D * agent3 = NULL;
-        unsigned long long scaled_u_list[U_LIST_LEN];
-        int sample_size = 1;
-        std::ofstream output_file;
-        std::ofstream output_file_sums; 
-        unsigned long long team1_area_total[U_LIST_LEN];
-        unsigned long long team2_area_total[U_LIST_LEN];
-
-        simulation_3D_1v3(agent_3D * solo_agent, agent_3D * agent1, agent_3D * agent2, 
-                          agent_3D * agent3, int sample_size, const char * file, const char * file_sum) {
-            this->solo_agent = solo_agent;
-            this->agent1 = agent1;
-            this->agent2 = agent2;
-            this->agent3 = agent3;
-            this->sample_size = sample_size;
-            double u_step = ((double) U_LIST_MAX) / ((double) U_LIST_LEN); 
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                scaled_u_list[i] = (int) round((i + 1) * u_step * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE);
-                team1_area_total[i] = 0;
-                team2_area_total[i] = 0;
-            }
-            srand(time(NULL));
-            output_file.open(file);
-            output_file_sums.open(file_sum);
-        }
-
-        void simulate_sample_size() {
-            output_file << "[";
-            for (int i = 0; i < sample_size; i++) {
-                simulate();
-                if (i != sample_size - 1) output_file << ", ";
-            }
-            output_file << "]";
-            output_file.close();
-
-            output_file_sums << "[";
-            for (int i = 0; i < U_LIST_LEN; i++) {
-                output_file_sums << "[" << team1_area_total[i] << ", " << team2_area_total[i] << "]";
-                if (i != U_LIST_LEN - 1) output_file_sums << ", "; 
-            }
-            output_file_sums << "]";
-            output_file_sums.close();
-        }
-
-        void simulate() {
-            this->agent1->t->reset_torus();
-            this->solo_agent->reset_agent();
-            this->agent1->reset_agent();
-            this->agent2->reset_agent();
-            this->agent3->reset_agent();
-            int current_u_list_position = 0;
-            output_file << "[";
-            for (long long i = 0; i < scaled_u_list[U_LIST_LEN - 1]; i++) {
-                unsigned long long total_area_covered = this->solo_agent->area_covered + this->agent1->area_covered + 
-                                                        this->agent2->area_covered + this->agent3->area_covered;
-                if (total_area_covered < TORUS_SIZE * TORUS_SIZE * TORUS_SIZE) {
-                    if (rand() % 2 == 0) {
-                        this->solo_agent->move();
-                        this->solo_agent->move();
-                        this->solo_agent->move();
-                        this->agent1->move();
-                        this->agent2->move();
-                        this->agent3->move();
-                    } else {
-                        this->agent1->move();
-                        this->agent2->move();
-                        this->agent3->move();
-                        this->solo_agent->move();
-                        this->solo_agent->move();
-                        this->solo_agent->move();
-                    }
-                }
-                if (i + 1 == scaled_u_list[current_u_list_position]) {
-                    unsigned long long team1_area_covered = this->solo_agent->area_covered;
-                    unsigned long long team2_area_covered = this->agent1->area_covered + this->agent2->area_covered + this->agent3->area_covered;
-                    team1_area_total[current_u_list_position] += team1_area_covered;
-                    team2_area_total[current_u_list_position] += team2_area_covered; 
-                    output_file << "[" << team1_area_covered << ", " << team2_area_covered << "]";
-                    if (i != (long long) (U_LIST_MAX) * TORUS_SIZE * TORUS_SIZE * TORUS_SIZE - 1) output_file << ", ";
-                    current_u_list_position++;
-                }
-            }
-            output_file << "]";
+        simulation_3D_1v3(agent_3D * solo_agent, agent_3D * agent1, agent_3D * agent2,
+                          agent_3D * agent3, int sample_size, const char * file, const char * file_sum, unsigned long long experiment_id = time(NULL))
+            : simulation<3>({{solo_agent}, {agent1, agent2, agent3}}, {3, 1}, sample_size, file, file_sum, experiment_id) {
+            this->scenario = "3D_1v3";
         }
 };
-
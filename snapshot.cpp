@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Snapshots of a running simulation, from which an interrupted run is
+ * resumed (see simulation::save_run and simulation::save_sample).
+ *
+ * The tori, agents and rng streams write their state with save(out) and
+ * read it back with load(in). Values are written as they are in memory,
+ * so a snapshot is meant to be resumed by the same build on the same
+ * machine, not to be kept or moved around like the output files.
+ */
+
+template <class T>
+void save_value(std::ostream & out, const T & value) {
+    out.write((const char *) &value, sizeof(T));
+}
+
+template <class T>
+void load_value(std::istream & in, T & value) {
+    in.read((char *) &value, sizeof(T));
+}
+
+template <class T>
+void save_vector(std::ostream & out, const std::vector<T> & values) {
+    save_value(out, (unsigned long long) values.size());
+    out.write((const char *) values.data(), values.size() * sizeof(T));
+}
+
+template <class T>
+void load_vector(std::istream & in, std::vector<T> & values) {
+    unsigned long long size = 0;
+    load_value(in, size);
+    if (!in) return;
+    values.resize(size);
+    in.read((char *) values.data(), size * sizeof(T));
+}
+
+inline void save_string(std::ostream & out, const std::string & text) {
+    save_value(out, (unsigned long long) text.size());
+    out.write(text.data(), text.size());
+}
+
+inline void load_string(std::istream & in, std::string & text) {
+    unsigned long long size = 0;
+    load_value(in, size);
+    if (!in) return;
+    text.resize(size);
+    in.read(&text[0], size);
+}
+
+// flushes what was written to the file to the disk
+inline void sync_file(const std::string & file) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+// cuts file back to its first end bytes, false if it is missing or shorter; an end of -1 leaves it alone
+inline bool cut_file(const std::string & file, long long end) {
+    if (end < 0) return true;
+    struct stat info;
+    if (stat(file.c_str(), &info) != 0 || info.st_size < end) return false;
+    return truncate(file.c_str(), end) == 0;
+}
+
+/*
+ * Replaces file with contents through a temporary file that is synced and
+ * then renamed over it, so that a crash leaves either the old or the new
+ * contents.
+ */
+inline bool replace_file(const std::string & file, const std::string & contents) {
+    std::string temporary = file + ".tmp";
+    FILE * out = fopen(temporary.c_str(), "wb");
+    if (out == NULL) return false;
+    bool written = fwrite(contents.data(), 1, contents.size(), out) == contents.size() && fflush(out) == 0 && fsync(fileno(out)) == 0;
+    fclose(out);
+    if (!written || rename(temporary.c_str(), file.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,221 @@
+#pragma once
+#include "parameters.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Mergeable quantiles of non-negative values, to a relative accuracy of
+ * QUANTILE_ACCURACY (the DDSketch of Masson, Rim and Lee).
+ *
+ * A value x > 0 is counted in bucket ceil(log(x) / log(gamma)) with
+ * gamma = (1 + a) / (1 - a), so every bucket spans values within a
+ * factor gamma of each other and the middle of a bucket is within a
+ * relative error a of every value in it. Zeros get a count of their own.
+ * Merging two sketches adds up their buckets, which gives the same sketch
+ * as adding all the values to one.
+ */
+class quantile_sketch {
+    public:
+        unsigned long long zeros = 0;
+        std::map<int, unsigned long long> buckets;
+
+        static double gamma() {
+            return (1 + QUANTILE_ACCURACY) / (1 - QUANTILE_ACCURACY);
+        }
+
+        void add(double x) {
+            if (x <= 0) {
+                this->zeros++;
+                return;
+            }
+            this->buckets[(int) ceil(log(x) / log(gamma()))]++;
+        }
+
+        void merge(quantile_sketch & other) {
+            this->zeros += other.zeros;
+            for (auto & bucket : other.buckets) {
+                this->buckets[bucket.first] += bucket.second;
+            }
+        }
+
+        unsigned long long count() {
+            unsigned long long count = this->zeros;
+            for (auto & bucket : this->buckets) {
+                count += bucket.second;
+            }
+            return count;
+        }
+
+        // the value of rank q * (count - 1), 0 <= q <= 1, for a sketch that is not empty
+        double quantile(double q) {
+            unsigned long long rank = (unsigned long long) (q * (count() - 1));
+            if (rank < this->zeros) return 0;
+            unsigned long long seen = this->zeros;
+            for (auto & bucket : this->buckets) {
+                seen += bucket.second;
+                if (rank < seen) return 2 * pow(gamma(), bucket.first) / (gamma() + 1);
+            }
+            return 2 * pow(gamma(), this->buckets.rbegin()->first) / (gamma() + 1);
+        }
+};
+
+/*
+ * Count, mean, variance, minimum, maximum and quantiles of a stream of
+ * values, in constant memory per value range.
+ *
+ * The mean and the sum of squared deviations m2 are updated with Welford's
+ * method, and two accumulators are merged with the pairwise update of Chan
+ * et al., so accumulators of threads, shards or earlier runs can be
+ * combined without their samples.
+ */
+class running_stats {
+    public:
+        unsigned long long count = 0;
+        double mean = 0;
+        double m2 = 0;
+        double min = 0;
+        double max = 0;
+        quantile_sketch quantiles;
+
+        void add(double x) {
+            this->count++;
+            double delta = x - this->mean;
+            this->mean += delta / this->count;
+            this->m2 += delta * (x - this->mean);
+            if (this->count == 1 || x < this->min) this->min = x;
+            if (this->count == 1 || x > this->max) this->max = x;
+            this->quantiles.add(x);
+        }
+
+        void merge(running_stats & other) {
+            if (other.count == 0) return;
+            if (this->count == 0) {
+                *this = other;
+                return;
+            }
+            unsigned long long count = this->count + other.count;
+            double delta = other.mean - this->mean;
+            this->mean += delta * other.count / count;
+            this->m2 += other.m2 + delta * delta * ((double) this->count * other.count / count);
+            this->count = count;
+            this->min = std::min(this->min, other.min);
+            this->max = std::max(this->max, other.max);
+            this->quantiles.merge(other.quantiles);
+        }
+
+        // the sample variance
+        double variance() {
+            return this->count > 1 ? this->m2 / (this->count - 1) : 0;
+        }
+
+        // the standard error of the mean
+        double standard_error() {
+            return this->count > 0 ? sqrt(variance() / this->count) : 0;
+        }
+
+        double quantile(double q) {
+            if (this->count == 0) return 0;
+            return std::min(this->max, std::max(this->min, this->quantiles.quantile(q)));
+        }
+
+        /*
+         * Writes "count mean sd min max p5 p25 p50 p75 p95 | m2 zeros
+         * bucket:count ...". The part after the bar is what read() needs
+         * besides the count, mean, min and max to restore the accumulator.
+         */
+        void write(std::ostream & out) {
+            std::ios_base::fmtflags flags = out.flags();
+            std::streamsize precision = out.precision();
+            int exact = std::numeric_limits<double>::max_digits10;
+            out << this->count << " " << std::setprecision(exact) << this->mean;
+            out << " " << std::fixed << std::setprecision(2) << sqrt(variance());
+            out << " " << std::defaultfloat << std::setprecision(exact) << this->min << " " << this->max;
+            out << std::fixed << std::setprecision(2);
+            for (double q : {0.05, 0.25, 0.5, 0.75, 0.95}) {
+                out << " " << quantile(q);
+            }
+            out << " | " << std::defaultfloat << std::setprecision(exact) << this->m2 << " " << this->quantiles.zeros;
+            for (auto & bucket : this->quantiles.buckets) {
+                out << " " << bucket.first << ":" << bucket.second;
+            }
+            out.flags(flags);
+            out.precision(precision);
+        }
+
+        // reads what write() wrote, false if it is malformed
+        bool read(std::istream & in) {
+            *this = running_stats();
+            double ignored;
+            in >> this->count >> this->mean >> ignored >> this->min >> this->max;
+            for (int i = 0; i < 5; i++) {
+                in >> ignored;
+            }
+            std::string bar;
+            in >> bar >> this->m2 >> this->quantiles.zeros;
+            if (!in || bar != "|") return false;
+            std::string bucket;
+            while (in >> bucket) {
+                // "index:count", with nothing else and neither number out of range
+                const char * text = bucket.c_str();
+                char * end;
+                errno = 0;
+                long index = strtol(text, &end, 10);
+                if (end == text || *end != ':' || errno != 0 || index < INT_MIN || index > INT_MAX) return false;
+                text = end + 1;
+                unsigned long long count = strtoull(text, &end, 10);
+                if (end == text || *end != '\0' || errno != 0 || *text == '-') return false;
+                this->quantiles.buckets[(int) index] = count;
+            }
+            return true;
+        }
+};
+
+/*
+ * The statistics section of a sums file: a line "statistics", a comment
+ * line naming the columns, and one line "name step team <running_stats>"
+ * per accumulator, e.g. the area of team 0 at the checkpoint at step 83.
+ */
+struct statistics_line {
+    std::string name;
+    long long step;
+    int team;
+    running_stats stats;
+};
+
+void write_statistics(std::ostream & out, std::vector<statistics_line> & lines) {
+    out << "statistics\n";
+    out << "# name step team count mean sd min max p5 p25 p50 p75 p95 | m2 zeros bucket:count ...\n";
+    for (statistics_line & line : lines) {
+        out << line.name << " " << line.step << " " << line.team << " ";
+        line.stats.write(out);
+        out << "\n";
+    }
+}
+
+// reads the statistics section of a sums file, false if there is none or it is malformed
+bool read_statistics(std::istream & in, std::vector<statistics_line> & lines) {
+    std::string text;
+    while (std::getline(in, text) && text != "statistics") {
+    }
+    if (!in) return false;
+    lines.clear();
+    while (std::getline(in, text)) {
+        if (text.empty() || text[0] == '#') continue;
+        std::istringstream fields(text);
+        statistics_line line;
+        fields >> line.name >> line.step >> line.team;
+        if (!fields || !line.stats.read(fields)) return false;
+        lines.push_back(line);
+    }
+    return true;
+}
@@ -1,28 +1,149 @@
+#pragma once
 #include "parameters.h"
+#include "rng.cpp"
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
 
 /*
- * A 1 dimensional torus 
+ * Spreads the low bits of v apart so that stride - 1 zero bits follow each
+ * of them, e.g. spread_bits(0b11, 2) == 0b0101. Used to interleave
+ * coordinates into Z-order (Morton) offsets.
+ */
+inline uint32_t spread_bits(uint32_t v, int stride) {
+    uint32_t res = 0;
+    for (int bit = 0; v >> bit; bit++) {
+        res |= ((v >> bit) & 1) << (bit * stride);
+    }
+    return res;
+}
+
+/*
+ * Remembers which RESET_CHUNK byte chunks of a grid were written since the
+ * last reset, so that a reset only has to clear those. Once more than half
+ * of the chunks are dirty a single memset of the whole grid is cheaper.
+ */
+class dirty_chunks {
+    public:
+        std::vector<uint8_t> is_dirty;
+        std::vector<size_t> dirty;
+
+        void init(size_t grid_bytes) {
+            this->is_dirty.assign((grid_bytes + RESET_CHUNK - 1) / RESET_CHUNK, 0);
+            this->dirty.clear();
+        }
+
+        void mark(size_t byte) {
+            size_t chunk = byte / RESET_CHUNK;
+            if (!this->is_dirty[chunk]) {
+                this->is_dirty[chunk] = 1;
+                this->dirty.push_back(chunk);
+            }
+        }
+
+        void mark_all() {
+            for (size_t chunk = 0; chunk < this->is_dirty.size(); chunk++) {
+                mark(chunk * RESET_CHUNK);
+            }
+        }
+
+        void clear(uint8_t * grid, size_t grid_bytes) {
+            if (this->dirty.size() > this->is_dirty.size() / 2) {
+                memset(grid, 0, grid_bytes);
+                memset(this->is_dirty.data(), 0, this->is_dirty.size());
+            } else {
+                for (size_t chunk : this->dirty) {
+                    size_t start = chunk * RESET_CHUNK;
+                    memset(grid + start, 0, std::min((size_t) RESET_CHUNK, grid_bytes - start));
+                    this->is_dirty[chunk] = 0;
+                }
+            }
+            this->dirty.clear();
+        }
+};
+
+/*
+ * A 1 dimensional torus with size sites
+ *
+ * With track_interface, claim() keeps interface, the number of neighbouring
+ * sites with different values, up to date.
  */
 class torus_1D {
     public:
-        uint8_t grid[TORUS_SIZE];
+        int size;
+        uint8_t * grid;
+        dirty_chunks written;
+        bool track_interface = false;
+        long interface = 0;
 
-        torus_1D() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                this->grid[i] = 0;
+        torus_1D(int size = TORUS_SIZE) {
+            this->size = size;
+            this->grid = new uint8_t[size]();
+            this->written.init(size);
+        }
+
+        ~torus_1D() {
+            delete[] this->grid;
+        }
+
+        // a new blank torus of the same size, for another worker thread
+        torus_1D * blank_copy() {
+            return new torus_1D(this->size);
+        }
+
+        // wraps a coordinate at most one lap outside of [0, size)
+        int wrap(int x) {
+            if (x < 0) return x + this->size;
+            if (x >= this->size) return x - this->size;
+            return x;
+        }
+
+        void set(int x, uint8_t value) {
+            this->grid[x] = value;
+            this->written.mark(x);
+        }
+
+        // sets the blank site x to id, an agent claiming it
+        void claim(int x, uint8_t id) {
+            set(x, id);
+            if (!this->track_interface) return;
+            for (int neighbour : {wrap(x - 1), wrap(x + 1)}) {
+                if (neighbour == x) continue;
+                this->interface += (this->grid[neighbour] != id) - (this->grid[neighbour] != BLANK);
             }
         }
 
         void reset_torus() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                this->grid[i] = 0;
+            this->written.clear(this->grid, this->size);
+            this->interface = 0;
+        }
+
+        void save(std::ostream & out) {
+            save_value(out, this->size);
+            save_value(out, this->interface);
+            out.write((const char *) this->grid, this->size);
+        }
+
+        // reads what save() wrote on a torus of the same size
+        void load(std::istream & in) {
+            int size = 0;
+            load_value(in, size);
+            if (size != this->size) {
+                in.setstate(std::ios::failbit);
+                return;
             }
+            load_value(in, this->interface);
+            in.read((char *) this->grid, this->size);
+            this->written.mark_all();
         }
         
         void print_torus() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
+            for (int i = 0; i < this->size; i++) {
                 std::cout << (int) this->grid[i] << " ";
             }
             std::cout << std::endl;
@@ -30,41 +151,310 @@ class torus_1D {
 };
 
 /*
- * A 2 dimensional torus
+ * A 2 dimensional torus with size x size sites
+ *
+ * layout picks where site (x, y) lives in memory: LAYOUT_ROW_MAJOR stores
+ * the grid row by row, LAYOUT_TILED stores TILE_SIDE x TILE_SIDE tiles one
+ * after the other (each tile row by row) and LAYOUT_MORTON orders the sites
+ * inside each tile along a Z curve. With tiles, neighbouring sites almost
+ * always share a page and usually a cache line. The grid is padded to a
+ * whole number of tiles.
+ *
+ * Sites take bits_per_site bits each: 8 stores the site values as they are,
+ * 4 and 2 pack several sites into each byte. A packed site holds BLANK,
+ * the agent ids 1 to 2^bits - 2 and MINE, which is stored as the all ones
+ * code, so 2 bits fit a 1v1 and 4 bits fit every team layout.
+ *
+ * With track_interface, claim() keeps interface, the number of neighbouring
+ * sites claimed by agent 1 and agent 2, up to date. With track_blocks it
+ * counts the claimed sites of every COVER_BLOCK x COVER_BLOCK block in
+ * block_claims, which covered_square() reads, and marks the chunks it
+ * writes in claimed_blocks so that a reset only clears those. With
+ * track_visits it keeps the step every site was claimed at in
+ * first_visit, row by row, as clock + 1, so that 0 is a site not claimed
+ * yet. The simulation sets clock to the number of the running step,
+ * counting from 1. Like the grid, first_visit only has the chunks written
+ * since the last reset cleared, and each_visit() only reads those.
+ *
+ * In every layout the position of a site is the sum of a part that only
+ * depends on x and a part that only depends on y, so index() adds two
+ * entries of row_offset and column_offset, tables worked out once per
+ * torus. The tables have a halo: they also hold the coordinates -1 and
+ * size, wrapped around, so that neighbour() finds the sites next to any
+ * site without wrapping its coordinates.
  */
 class torus_2D {
     public:
-        uint8_t grid[TORUS_SIZE][TORUS_SIZE];
+        int size;
+        int bits_per_site;
+        uint8_t code_mask;
+        int layout;
+        int tiles_per_side;
+        uint8_t * grid;
+        dirty_chunks written;
+        bool track_interface = false;
+        long interface = 0;
+        bool track_blocks = false;
+        int blocks_per_side;
+        std::vector<uint16_t> block_claims;
+        dirty_chunks claimed_blocks;
+        bool track_visits = false;
+        uint32_t clock = 0;
+        std::vector<uint32_t> first_visit;
+        dirty_chunks visited;
+        // the parts of index() for x and y, entry c + 1 for the coordinate c in [-1, size]
+        std::vector<size_t> row_offset;
+        std::vector<size_t> column_offset;
 
-        torus_2D() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    this->grid[i][j] = 0;
+        torus_2D(int size = TORUS_SIZE, int bits_per_site = GRID_BITS, int layout = GRID_LAYOUT) {
+            this->size = size;
+            this->bits_per_site = bits_per_site;
+            this->code_mask = (1 << bits_per_site) - 1;
+            this->layout = layout;
+            this->tiles_per_side = (size + TILE_SIDE - 1) / TILE_SIDE;
+            this->blocks_per_side = (size + COVER_BLOCK - 1) / COVER_BLOCK;
+            uint32_t morton_offset[TILE_SIDE];
+            for (int i = 0; i < TILE_SIDE; i++) {
+                morton_offset[i] = spread_bits(i, 2);
+            }
+            for (int c = -1; c <= size; c++) {
+                unsigned int u = wrap(c);
+                size_t row = (size_t) (u / TILE_SIDE) * this->tiles_per_side * TILE_AREA;
+                size_t column = (size_t) (u / TILE_SIDE) * TILE_AREA;
+                if (layout == LAYOUT_ROW_MAJOR) {
+                    row = (size_t) u * size;
+                    column = u;
+                } else if (layout == LAYOUT_MORTON) {
+                    row += morton_offset[u % TILE_SIDE] << 1;
+                    column += morton_offset[u % TILE_SIDE];
+                } else {
+                    row += (u % TILE_SIDE) * TILE_SIDE;
+                    column += u % TILE_SIDE;
                 }
+                this->row_offset.push_back(row);
+                this->column_offset.push_back(column);
             }
+            // the padding lets step_lanes read any site as the low byte of 4
+            this->grid = new uint8_t[grid_bytes() + 3]();
+            this->written.init(grid_bytes());
+        }
+
+        ~torus_2D() {
+            delete[] this->grid;
+        }
+
+        // a new blank torus with the same size, packing and layout, for another worker thread
+        torus_2D * blank_copy() {
+            return new torus_2D(this->size, this->bits_per_site, this->layout);
         }
 
+        // wraps a coordinate at most one lap outside of [0, size)
+        int wrap(int x) {
+            if (x < 0) return x + this->size;
+            if (x >= this->size) return x - this->size;
+            return x;
+        }
+
+        // largest agent id a site can hold
+        int max_id() {
+            if (this->bits_per_site == 8) return 255;
+            return this->code_mask - 1;
+        }
+
+        // position of site (x, y) in the grid, for x and y in [-1, size], wrapped around
+        size_t index(int x, int y) {
+            return this->row_offset[x + 1] + this->column_offset[y + 1];
+        }
+
+        // position of the site next to (x, y) in direction, one of RIGHT, UP, LEFT and DOWN
+        size_t neighbour(int x, int y, int direction) {
+            return index(x + dirx[direction], y + diry[direction]);
+        }
+
+        // positions of the four sites next to (x, y), in the order RIGHT, UP, LEFT, DOWN
+        void neighbours(int x, int y, size_t sites[4]) {
+            size_t row = this->row_offset[x + 1], column = this->column_offset[y + 1];
+            sites[0] = this->row_offset[x + 2] + column;
+            sites[1] = row + this->column_offset[y + 2];
+            sites[2] = this->row_offset[x] + column;
+            sites[3] = row + this->column_offset[y];
+        }
+
+        uint8_t get(int x, int y) {
+            return get_site(index(x, y));
+        }
+
+        void set(int x, int y, uint8_t value) {
+            set_site(index(x, y), value);
+        }
+
+        // sets the blank site (x, y) to id, an agent claiming it
+        void claim(int x, int y, uint8_t id) {
+            claim_site(index(x, y), x, y, id);
+        }
+
+        // the same for the site at position i in the grid, (x, y)
+        void claim_site(size_t i, int x, int y, uint8_t id) {
+            set_site(i, id);
+            if (this->track_blocks) {
+                size_t block = (size_t) (x / COVER_BLOCK) * this->blocks_per_side + y / COVER_BLOCK;
+                this->block_claims[block]++;
+                this->claimed_blocks.mark(block * sizeof(uint16_t));
+            }
+            if (this->track_visits) {
+                size_t site = (size_t) x * this->size + y;
+                this->first_visit[site] = this->clock + 1;
+                this->visited.mark(site * sizeof(uint32_t));
+            }
+            if (!this->track_interface || (id != 1 && id != 2)) return;
+            uint8_t other = 3 - id;
+            size_t sites[4];
+            neighbours(x, y, sites);
+            for (size_t site : sites) {
+                this->interface += get_site(site) == other;
+            }
+        }
+
+        // whether every site within radius of (x, y) along both axes is claimed, with track_blocks
+        bool covered_square(int x, int y, int radius) {
+            int n = this->size;
+            int first_x = ((x - radius) % n + n) % n;
+            int first_y = ((y - radius) % n + n) % n;
+            return every_block_along(first_x, 2 * radius + 1, [&](int bx) {
+                return every_block_along(first_y, 2 * radius + 1, [&](int by) {
+                    return full_block(bx, by);
+                });
+            });
+        }
+
+        // whether f(block) holds for the blocks of the length sites from first on along an axis, wrapping around
+        template <class F>
+        bool every_block_along(int first, int length, F f) {
+            while (length > 0) {
+                int block = first / COVER_BLOCK;
+                int sites = std::min((block + 1) * COVER_BLOCK, this->size) - first;
+                if (!f(block)) return false;
+                length -= sites;
+                first += sites;
+                if (first == this->size) first = 0;
+            }
+            return true;
+        }
+
+        bool full_block(int bx, int by) {
+            int width = std::min(COVER_BLOCK, this->size - bx * COVER_BLOCK);
+            int height = std::min(COVER_BLOCK, this->size - by * COVER_BLOCK);
+            return this->block_claims[(size_t) bx * this->blocks_per_side + by] == width * height;
+        }
+
+        uint8_t get_site(size_t i) {
+            if (this->bits_per_site == 8) return this->grid[i];
+            size_t bit = i * this->bits_per_site;
+            uint8_t code = (this->grid[bit >> 3] >> (bit & 7)) & this->code_mask;
+            return code == this->code_mask ? MINE : code;
+        }
+
+        void set_site(size_t i, uint8_t value) {
+            if (this->bits_per_site == 8) {
+                this->grid[i] = value;
+                this->written.mark(i);
+                return;
+            }
+            size_t bit = i * this->bits_per_site;
+            this->written.mark(bit >> 3);
+            uint8_t code = value == MINE ? this->code_mask : value;
+            uint8_t & byte = this->grid[bit >> 3];
+            byte = (byte & ~(this->code_mask << (bit & 7))) | (code << (bit & 7));
+        }
+
+        size_t grid_sites() {
+            if (this->layout == LAYOUT_ROW_MAJOR) return (size_t) this->size * this->size;
+            return (size_t) this->tiles_per_side * this->tiles_per_side * TILE_AREA;
+        }
+
+        size_t grid_bytes() {
+            return (grid_sites() * this->bits_per_site + 7) / 8;
+        }
+
+        // clears the tiles written since the last reset
         void reset_torus() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    this->grid[i][j] = 0;
+            this->written.clear(this->grid, grid_bytes());
+            this->interface = 0;
+            this->clock = 0;
+            if (this->track_blocks) {
+                size_t blocks = (size_t) this->blocks_per_side * this->blocks_per_side;
+                if (this->block_claims.size() != blocks) {
+                    this->block_claims.assign(blocks, 0);
+                    this->claimed_blocks.init(blocks * sizeof(uint16_t));
+                } else {
+                    this->claimed_blocks.clear((uint8_t *) this->block_claims.data(), blocks * sizeof(uint16_t));
+                }
+            }
+            if (this->track_visits) {
+                size_t sites = (size_t) this->size * this->size;
+                if (this->first_visit.size() != sites) {
+                    this->first_visit.assign(sites, 0);
+                    this->visited.init(sites * sizeof(uint32_t));
+                } else {
+                    this->visited.clear((uint8_t *) this->first_visit.data(), sites * sizeof(uint32_t));
+                }
+            }
+        }
+
+        // calls f(site, stamp) for every site of first_visit, row by row, with a stamp above 0
+        template <class F>
+        void each_visit(F f) {
+            const size_t per_chunk = RESET_CHUNK / sizeof(uint32_t);
+            for (size_t chunk = 0; chunk < this->visited.is_dirty.size(); chunk++) {
+                if (!this->visited.is_dirty[chunk]) continue;
+                size_t end = std::min((chunk + 1) * per_chunk, this->first_visit.size());
+                for (size_t site = chunk * per_chunk; site < end; site++) {
+                    if (this->first_visit[site] != 0) f(site, this->first_visit[site]);
                 }
             }
         }
 
-        void reset_torus_with_mines(double m) {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    this->grid[i][j] = 0;
-                    if ((((double) rand()) / RAND_MAX ) < m) this->grid[i][j] = MINE;
+        void save(std::ostream & out) {
+            save_value(out, this->size);
+            save_value(out, this->bits_per_site);
+            save_value(out, this->layout);
+            save_value(out, this->interface);
+            out.write((const char *) this->grid, grid_bytes());
+            if (this->track_visits) out.write((const char *) this->first_visit.data(), this->first_visit.size() * sizeof(uint32_t));
+        }
+
+        // reads what save() wrote on a torus of the same size, packing and layout
+        void load(std::istream & in) {
+            int size = 0, bits_per_site = 0, layout = 0;
+            load_value(in, size);
+            load_value(in, bits_per_site);
+            load_value(in, layout);
+            if (size != this->size || bits_per_site != this->bits_per_site || layout != this->layout) {
+                in.setstate(std::ios::failbit);
+                return;
+            }
+            load_value(in, this->interface);
+            in.read((char *) this->grid, grid_bytes());
+            this->written.mark_all();
+            if (this->track_visits) {
+                in.read((char *) this->first_visit.data(), this->first_visit.size() * sizeof(uint32_t));
+                this->visited.mark_all();
+            }
+        }
+
+        void reset_torus_with_mines(double m, rng_stream & rng) {
+            reset_torus();
+            for (int x = 0; x < this->size; x++) {
+                for (int y = 0; y < this->size; y++) {
+                    if (rng.next_double() < m) set(x, y, MINE);
                 }
             }
         }
 
         void print_torus() {
-            for (int x = 0; x < TORUS_SIZE; x++) {
-                for (int y = 0; y < TORUS_SIZE; y++) {
-                    std::cout << (int) this->grid[x][y] << " "; 
+            for (int x = 0; x < this->size; x++) {
+                for (int y = 0; y < this->size; y++) {
+                    std::cout << (int) get(x, y) << " "; 
                 }
                 std::cout << std::endl;
             }
@@ -72,45 +462,302 @@ class torus_2D {
         }
 };
 
+static_assert(BRICK_VOLUME <= 1 << SITE_KEY_BRICK && SUPERBRICK_VOLUME <= 1 << (SITE_KEY_SUPERBRICK - SITE_KEY_BRICK), "a site key holds the offset in the brick and the brick in the superbrick");
+
 /*
  * A 3 dimensional torus
+ *
+ * A dense grid would need size^3 bytes, so the sites are stored in
+ * bricks of BRICK_SIDE^3 bytes that are only allocated the first time a
+ * site inside them is written. Bricks are found through a two level
+ * directory: a flat table of superbricks, each holding a table of
+ * SUPERBRICK_SIDE^3 brick pointers. Reading a site whose brick was never
+ * written returns BLANK.
+ *
+ * Inside a brick the sites are stored row by row, or along a Z curve
+ * when layout is LAYOUT_MORTON.
+ *
+ * reset_torus only clears the bricks touched since the last reset and
+ * keeps them in a pool for the next sample.
+ *
+ * A site is found by its key, its superbrick, its brick in the superbrick
+ * and its offset in the brick packed into one word (see SITE_KEY_BRICK).
+ * Each of the three is a sum of parts for x, y and z, so the key is too:
+ * site_key() adds an entry of each of the axis_key tables, which like
+ * those of torus_2D have a halo for the coordinates -1 and size, and
+ * neighbour() gives the key of the site next to a site without wrapping.
  */
 class torus_3D {
     public:
         int size;
-        uint8_t grid[TORUS_SIZE][TORUS_SIZE][TORUS_SIZE];
-
-        torus_3D() {
-            this->size = TORUS_SIZE;
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    for (int k = 0; k < TORUS_SIZE; k++) {
-                        this->grid[i][j][k] = 0;
-                    }
-                }
+        int layout;
+        int superbricks_per_side;
+        uint8_t *** superbricks;
+        std::vector<uint8_t **> touched_slots;
+        std::vector<uint8_t *> free_bricks;
+        // the parts of site_key() for x, y and z, entry c + 1 for the coordinate c in [-1, size]
+        std::vector<uint64_t> axis_key[3];
+
+        torus_3D(int size = TORUS_SIZE, int layout = GRID_LAYOUT) {
+            this->size = size;
+            this->layout = layout;
+            for (int i = 0; i < BRICK_SIDE; i++) {
+                this->morton_offset[i] = spread_bits(i, 3);
+            }
+            int sites_per_superbrick = BRICK_SIDE * SUPERBRICK_SIDE;
+            this->superbricks_per_side = (this->size + sites_per_superbrick - 1) / sites_per_superbrick;
+            long long superbrick_count = (long long) this->superbricks_per_side * this->superbricks_per_side * this->superbricks_per_side;
+            this->superbricks = new uint8_t **[superbrick_count]();
+            for (int c = -1; c <= size; c++) {
+                int u = wrap(c);
+                this->axis_key[0].push_back(key(u, 0, 0));
+                this->axis_key[1].push_back(key(0, u, 0));
+                this->axis_key[2].push_back(key(0, 0, u));
+            }
+        }
+
+        ~torus_3D() {
+            reset_torus();
+            for (uint8_t * brick : this->free_bricks) {
+                delete[] brick;
+            }
+            long long superbrick_count = (long long) this->superbricks_per_side * this->superbricks_per_side * this->superbricks_per_side;
+            for (long long i = 0; i < superbrick_count; i++) {
+                delete[] this->superbricks[i];
             }
+            delete[] this->superbricks;
+        }
+
+        // a new blank torus with the same size and layout, for another worker thread
+        torus_3D * blank_copy() {
+            return new torus_3D(this->size, this->layout);
+        }
+
+        // wraps a coordinate at most one lap outside of [0, size)
+        int wrap(int x) {
+            if (x < 0) return x + this->size;
+            if (x >= this->size) return x - this->size;
+            return x;
+        }
+
+        // the key of site (x, y, z), for x, y and z in [-1, size], wrapped around
+        uint64_t site_key(int x, int y, int z) {
+            return this->axis_key[0][x + 1] + this->axis_key[1][y + 1] + this->axis_key[2][z + 1];
+        }
+
+        // the key of the site next to (x, y, z) in direction
+        uint64_t neighbour(int x, int y, int z, int direction) {
+            return site_key(x + dirx[direction], y + diry[direction], z + dirz[direction]);
+        }
+
+        // the keys of the six sites next to (x, y, z), in the order of the directions RIGHT to ZDOWN
+        void neighbours(int x, int y, int z, uint64_t keys[6]) {
+            for (int direction = 0; direction < 6; direction++) {
+                keys[direction] = neighbour(x, y, z, direction);
+            }
+        }
+
+        uint8_t get(int x, int y, int z) {
+            return get_site(site_key(x, y, z));
+        }
+
+        void set(int x, int y, int z, uint8_t value) {
+            set_site(site_key(x, y, z), value);
+        }
+
+        uint8_t get_site(uint64_t key) {
+            uint8_t ** superbrick = this->superbricks[key >> SITE_KEY_SUPERBRICK];
+            if (superbrick == NULL) return BLANK;
+            uint8_t * brick = superbrick[(key >> SITE_KEY_BRICK) & ((1 << (SITE_KEY_SUPERBRICK - SITE_KEY_BRICK)) - 1)];
+            if (brick == NULL) return BLANK;
+            return brick[key & ((1 << SITE_KEY_BRICK) - 1)];
+        }
+
+        void set_site(uint64_t key, uint8_t value) {
+            uint64_t s = key >> SITE_KEY_SUPERBRICK;
+            if (this->superbricks[s] == NULL) {
+                if (value == BLANK) return;
+                this->superbricks[s] = new uint8_t *[SUPERBRICK_VOLUME]();
+            }
+            uint8_t ** slot = &this->superbricks[s][(key >> SITE_KEY_BRICK) & ((1 << (SITE_KEY_SUPERBRICK - SITE_KEY_BRICK)) - 1)];
+            if (*slot == NULL) {
+                if (value == BLANK) return;
+                *slot = allocate_brick();
+                this->touched_slots.push_back(slot);
+            }
+            (*slot)[key & ((1 << SITE_KEY_BRICK) - 1)] = value;
         }
 
         void reset_torus() {
-            for (int i = 0; i < TORUS_SIZE; i++) {
-                for (int j = 0; j < TORUS_SIZE; j++) {
-                    for (int k = 0; k < TORUS_SIZE; k++) {
-                        this->grid[i][j][k] = 0;
-                    }
+            for (uint8_t ** slot : this->touched_slots) {
+                memset(*slot, BLANK, BRICK_VOLUME);
+                this->free_bricks.push_back(*slot);
+                *slot = NULL;
+            }
+            this->touched_slots.clear();
+        }
+
+        // the allocated bricks, as their superbrick, their slot in it and their sites
+        void save(std::ostream & out) {
+            save_value(out, this->size);
+            save_value(out, this->layout);
+            save_value(out, (unsigned long long) this->touched_slots.size());
+            long long superbrick_count = (long long) this->superbricks_per_side * this->superbricks_per_side * this->superbricks_per_side;
+            for (long long s = 0; s < superbrick_count; s++) {
+                if (this->superbricks[s] == NULL) continue;
+                for (int b = 0; b < SUPERBRICK_VOLUME; b++) {
+                    if (this->superbricks[s][b] == NULL) continue;
+                    save_value(out, s);
+                    save_value(out, b);
+                    out.write((const char *) this->superbricks[s][b], BRICK_VOLUME);
+                }
+            }
+        }
+
+        // reads what save() wrote on a torus of the same size and layout
+        void load(std::istream & in) {
+            int size = 0, layout = 0;
+            unsigned long long bricks = 0;
+            load_value(in, size);
+            load_value(in, layout);
+            load_value(in, bricks);
+            if (size != this->size || layout != this->layout) {
+                in.setstate(std::ios::failbit);
+                return;
+            }
+            reset_torus();
+            long long superbrick_count = (long long) this->superbricks_per_side * this->superbricks_per_side * this->superbricks_per_side;
+            for (unsigned long long i = 0; i < bricks; i++) {
+                long long s = -1;
+                int b = -1;
+                load_value(in, s);
+                load_value(in, b);
+                if (!in || s < 0 || s >= superbrick_count || b < 0 || b >= SUPERBRICK_VOLUME) {
+                    in.setstate(std::ios::failbit);
+                    return;
+                }
+                if (this->superbricks[s] == NULL) this->superbricks[s] = new uint8_t *[SUPERBRICK_VOLUME]();
+                uint8_t ** slot = &this->superbricks[s][b];
+                if (*slot == NULL) {
+                    *slot = allocate_brick();
+                    this->touched_slots.push_back(slot);
                 }
+                in.read((char *) *slot, BRICK_VOLUME);
             }
         }
 
+        unsigned long long allocated_bytes() {
+            return (unsigned long long) (this->touched_slots.size() + this->free_bricks.size()) * BRICK_VOLUME;
+        }
+
+        // the most bytes a torus of this size can take when at most visits sites are claimed: the
+        // bricks, the brick table of every superbrick they are in and the table of superbricks
+        static unsigned long long max_allocated_bytes(int size, unsigned long long visits) {
+            unsigned long long bricks_per_side = (size + BRICK_SIDE - 1) / BRICK_SIDE;
+            unsigned long long superbricks_per_side = (size + BRICK_SIDE * SUPERBRICK_SIDE - 1) / (BRICK_SIDE * SUPERBRICK_SIDE);
+            unsigned long long superbrick_count = superbricks_per_side * superbricks_per_side * superbricks_per_side;
+            return std::min(visits, bricks_per_side * bricks_per_side * bricks_per_side) * BRICK_VOLUME
+                + std::min(visits, superbrick_count) * SUPERBRICK_VOLUME * sizeof(uint8_t *)
+                + superbrick_count * sizeof(uint8_t **);
+        }
+
         void print_torus() {
-            for (int z = TORUS_SIZE - 1; z >= 0; z--) {
-                for (int y = TORUS_SIZE - 1; y >= 0; y--) {
-                    for (int x = 0; x < TORUS_SIZE; x++) {
-                        std::cout << this->grid[x][y][z] << " "; 
+            for (int z = this->size - 1; z >= 0; z--) {
+                for (int y = this->size - 1; y >= 0; y--) {
+                    for (int x = 0; x < this->size; x++) {
+                        std::cout << (int) get(x, y, z) << " "; 
                     }
                     std::cout << std::endl;
                 }
                 std::cout << std::endl;
             }
         }
+
+    private:
+        uint32_t morton_offset[BRICK_SIDE];
+
+        // the key of (x, y, z) in [0, size), from the superbrick, brick and offset it is at
+        uint64_t key(int x, int y, int z) {
+            return (uint64_t) superbrick_index(x, y, z) << SITE_KEY_SUPERBRICK | (uint64_t) brick_index(x, y, z) << SITE_KEY_BRICK | brick_offset(x, y, z);
+        }
+
+        long long superbrick_index(int x, int y, int z) {
+            int sites_per_superbrick = BRICK_SIDE * SUPERBRICK_SIDE;
+            return ((long long) (x / sites_per_superbrick) * this->superbricks_per_side 
+                    + y / sites_per_superbrick) * this->superbricks_per_side + z / sites_per_superbrick;
+        }
+
+        int brick_index(int x, int y, int z) {
+            int bx = (x / BRICK_SIDE) % SUPERBRICK_SIDE;
+            int by = (y / BRICK_SIDE) % SUPERBRICK_SIDE;
+            int bz = (z / BRICK_SIDE) % SUPERBRICK_SIDE;
+            return (bx * SUPERBRICK_SIDE + by) * SUPERBRICK_SIDE + bz;
+        }
+
+        int brick_offset(int x, int y, int z) {
+            if (this->layout == LAYOUT_MORTON) {
+                return this->morton_offset[x % BRICK_SIDE] << 2 | this->morton_offset[y % BRICK_SIDE] << 1 | this->morton_offset[z % BRICK_SIDE];
+            }
+            return ((x % BRICK_SIDE) * BRICK_SIDE + y % BRICK_SIDE) * BRICK_SIDE + z % BRICK_SIDE;
+        }
+
+        uint8_t * allocate_brick() {
+            if (this->free_bricks.empty()) return new uint8_t[BRICK_VOLUME]();
+            uint8_t * brick = this->free_bricks.back();
+            this->free_bricks.pop_back();
+            return brick;
+        }
 };
 
+/*
+ * Tori kept for reuse between the simulations of a batch, so that
+ * experiments of the same size do not allocate their tori again. take()
+ * hands out a torus of the given size (in the default layout) released
+ * before, or a new one; a taken torus holds whatever its last sample left
+ * on it, which the next sample resets as it starts. expect() and done()
+ * count the simulations of every size still to finish, and the tori of a
+ * size are only kept while there are some.
+ */
+template <class Torus>
+class torus_pool {
+    public:
+        std::mutex lock;
+        std::multimap<int, Torus *> idle;
+        std::map<int, int> expected;
+
+        ~torus_pool() {
+            for (auto & entry : this->idle) {
+                delete entry.second;
+            }
+        }
+
+        void expect(int size) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->expected[size]++;
+        }
+
+        void done(int size) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (--this->expected[size] > 0) return;
+            auto range = this->idle.equal_range(size);
+            for (auto entry = range.first; entry != range.second; entry++) {
+                delete entry->second;
+            }
+            this->idle.erase(range.first, range.second);
+        }
+
+        Torus * take(int size) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            auto entry = this->idle.find(size);
+            if (entry == this->idle.end()) return new Torus(size);
+            Torus * t = entry->second;
+            this->idle.erase(entry);
+            return t;
+        }
+
+        void release(Torus * t) {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->expected[t->size] > 0) this->idle.insert({t->size, t});
+            else delete t;
+        }
+};
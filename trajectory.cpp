@@ -0,0 +1,318 @@
+#pragma once
+#include "parameters.h"
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Binary trajectory files.
+ *
+ * With output_format BINARY_OUTPUT a simulation writes its output file as a
+ * header followed by one record per sample, in sample order. Every number
+ * is little endian. The header is
+ *
+ *     "RWTRAJ01"                          8 bytes
+ *     header bytes, including the magic   uint32
+ *     dimension                           uint32
+ *     torus size n                        uint64
+ *     experiment id (the seed)            uint64
+ *     sample size                         uint64
+ *     flags, TRAJECTORY_*                 uint32
+ *     scenario name                       uint32 length, then the characters
+ *     mine chance                         float64
+ *     start distance, -1 for random       int32
+ *     teams                               uint32
+ *     per team: moves per step, agents,   uint32, uint32,
+ *               their strategies          uint32 each
+ *     checkpoints                         uint64
+ *     the checkpoint steps                uint64 each
+ *
+ * and a record holds the area covered at every checkpoint, team after team
+ * within a checkpoint, as uint64s, then the interface as an int64 with
+ * TRAJECTORY_INTERFACE, or the interface at every checkpoint as int64s
+ * with TRAJECTORY_INTERFACE_SERIES as well, then with TRAJECTORY_SITES the
+ * number of interface sites and the sites (the 1D output) as uint64s.
+ */
+
+// the record holds the interface between the two teams
+#define TRAJECTORY_INTERFACE 1
+// the record ends with a variable number of interface sites
+#define TRAJECTORY_SITES 2
+// the record holds the interface at every checkpoint, not just at the end
+#define TRAJECTORY_INTERFACE_SERIES 4
+
+const char trajectory_magic[8] = {'R', 'W', 'T', 'R', 'A', 'J', '0', '1'};
+
+struct trajectory_header {
+    std::string scenario;
+    unsigned int dimension = 2;
+    unsigned long long torus_size = 0;
+    unsigned long long experiment_id = 0;
+    unsigned long long sample_size = 0;
+    unsigned int flags = 0;
+    double mine_chance = 0;
+    int distance = -1;
+    std::vector<unsigned int> moves_per_step;
+    std::vector<std::vector<unsigned int>> strategies;
+    std::vector<unsigned long long> checkpoints;
+
+    // the interfaces in a record
+    unsigned long long interface_words() {
+        if (!(this->flags & TRAJECTORY_INTERFACE)) return 0;
+        return (this->flags & TRAJECTORY_INTERFACE_SERIES) ? this->checkpoints.size() : 1;
+    }
+
+    // the uint64s before the sites of a record
+    unsigned long long record_words() {
+        return this->checkpoints.size() * this->strategies.size() + interface_words();
+    }
+};
+
+inline void put_u32(std::vector<unsigned char> & out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+inline void put_u64(std::vector<unsigned char> & out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+inline uint32_t get_u32(const unsigned char * in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) {
+        value = value << 8 | in[i];
+    }
+    return value;
+}
+
+inline uint64_t get_u64(const unsigned char * in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = value << 8 | in[i];
+    }
+    return value;
+}
+
+void write_trajectory_header(std::ostream & out, trajectory_header & header) {
+    std::vector<unsigned char> bytes(trajectory_magic, trajectory_magic + 8);
+    put_u32(bytes, 0); // the header size, filled in below
+    put_u32(bytes, header.dimension);
+    put_u64(bytes, header.torus_size);
+    put_u64(bytes, header.experiment_id);
+    put_u64(bytes, header.sample_size);
+    put_u32(bytes, header.flags);
+    put_u32(bytes, header.scenario.size());
+    bytes.insert(bytes.end(), header.scenario.begin(), header.scenario.end());
+    uint64_t mine_chance_bits;
+    memcpy(&mine_chance_bits, &header.mine_chance, 8);
+    put_u64(bytes, mine_chance_bits);
+    put_u32(bytes, (uint32_t) header.distance);
+    put_u32(bytes, header.strategies.size());
+    for (size_t team = 0; team < header.strategies.size(); team++) {
+        put_u32(bytes, header.moves_per_step[team]);
+        put_u32(bytes, header.strategies[team].size());
+        for (unsigned int strategy : header.strategies[team]) {
+            put_u32(bytes, strategy);
+        }
+    }
+    put_u64(bytes, header.checkpoints.size());
+    for (unsigned long long checkpoint : header.checkpoints) {
+        put_u64(bytes, checkpoint);
+    }
+    uint32_t size = bytes.size();
+    for (int i = 0; i < 4; i++) {
+        bytes[8 + i] = (size >> (8 * i)) & 0xFF;
+    }
+    out.write((const char *) bytes.data(), bytes.size());
+}
+
+/*
+ * Writes the checkpoints of a sample, as "a, b, ..." for one team and as
+ * "[a1, b1], [a2, b2], ..." for two.
+ */
+template <class Areas>
+void write_checkpoints(std::ostream & out, Areas & areas, int teams) {
+    for (size_t i = 0; i < areas.size(); i += teams) {
+        if (i != 0) out << ", ";
+        if (teams == 1) {
+            out << areas[i];
+        } else {
+            out << "[" << areas[i] << ", " << areas[i + 1] << "]";
+        }
+    }
+}
+
+/*
+ * A trajectory file mapped into memory. open() checks the header and finds
+ * where every record starts; the accessors then read the mapped records
+ * directly, so slicing a few samples or checkpoints out of a large file
+ * only touches the pages they are on.
+ */
+class trajectory_reader {
+    public:
+        trajectory_header header;
+        const unsigned char * data = NULL;
+        size_t size = 0;
+        std::vector<size_t> record_offsets;
+
+        ~trajectory_reader() {
+            if (this->data != NULL) munmap((void *) this->data, this->size);
+        }
+
+        // false, with a message on std::cerr, if the file is missing or not a complete trajectory file
+        bool open(const char * file) {
+            int fd = ::open(file, O_RDONLY);
+            if (fd < 0) {
+                std::cerr << "cannot open " << file << std::endl;
+                return false;
+            }
+            struct stat info;
+            fstat(fd, &info);
+            this->size = info.st_size;
+            if (this->size > 0) {
+                void * mapped = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED) this->data = (const unsigned char *) mapped;
+            }
+            close(fd);
+            if (this->data == NULL || !read_header()) {
+                std::cerr << file << " is not a trajectory file" << std::endl;
+                return false;
+            }
+            size_t offset = get_u32(this->data + 8);
+            unsigned long long words = this->header.record_words();
+            for (unsigned long long sample = 0; sample < this->header.sample_size; sample++) {
+                // the site counts come from the file, so they are checked against what is left of it before they are added
+                bool fits = words <= (this->size - offset) / 8;
+                size_t end = offset + 8 * words;
+                if (fits && (this->header.flags & TRAJECTORY_SITES)) {
+                    fits = this->size - end >= 8 && get_u64(this->data + end) <= (this->size - end - 8) / 8;
+                    if (fits) end += 8 + 8 * get_u64(this->data + end);
+                }
+                if (!fits) {
+                    std::cerr << file << " ends after " << sample << " of " << this->header.sample_size << " samples" << std::endl;
+                    return false;
+                }
+                this->record_offsets.push_back(offset);
+                offset = end;
+            }
+            return true;
+        }
+
+        unsigned long long samples() {
+            return this->record_offsets.size();
+        }
+
+        unsigned long long area(unsigned long long sample, unsigned long long checkpoint, unsigned int team) {
+            return get_u64(this->data + this->record_offsets[sample] + 8 * (checkpoint * this->header.strategies.size() + team));
+        }
+
+        // the interface at the end of a sample
+        long long interface(unsigned long long sample) {
+            return (long long) get_u64(this->data + this->record_offsets[sample] + 8 * (this->header.record_words() - 1));
+        }
+
+        // the interface at every checkpoint with TRAJECTORY_INTERFACE_SERIES, otherwise just at the end
+        std::vector<long long> interfaces(unsigned long long sample) {
+            std::vector<long long> interfaces(this->header.interface_words());
+            const unsigned char * in = this->data + this->record_offsets[sample] + 8 * (this->header.record_words() - interfaces.size());
+            for (size_t i = 0; i < interfaces.size(); i++) {
+                interfaces[i] = (long long) get_u64(in + 8 * i);
+            }
+            return interfaces;
+        }
+
+        std::vector<unsigned long long> sites(unsigned long long sample) {
+            const unsigned char * in = this->data + this->record_offsets[sample] + 8 * this->header.record_words();
+            std::vector<unsigned long long> sites(get_u64(in));
+            for (size_t i = 0; i < sites.size(); i++) {
+                sites[i] = get_u64(in + 8 * (i + 1));
+            }
+            return sites;
+        }
+
+        // the areas of a sample, as areas[checkpoint * teams + team]
+        std::vector<unsigned long long> areas(unsigned long long sample) {
+            std::vector<unsigned long long> areas(this->header.checkpoints.size() * this->header.strategies.size());
+            for (size_t i = 0; i < areas.size(); i++) {
+                areas[i] = get_u64(this->data + this->record_offsets[sample] + 8 * i);
+            }
+            return areas;
+        }
+
+        // writes the samples in the text format the simulation writes with TEXT_OUTPUT
+        void export_text(std::ostream & out) {
+            if (this->header.flags & TRAJECTORY_SITES) {
+                for (unsigned long long sample = 0; sample < samples(); sample++) {
+                    for (unsigned long long site : sites(sample)) {
+                        out << site << " ";
+                    }
+                    out << "\n";
+                }
+                return;
+            }
+            out << "[";
+            for (unsigned long long sample = 0; sample < samples(); sample++) {
+                std::vector<unsigned long long> sample_areas = areas(sample);
+                out << "[";
+                write_checkpoints(out, sample_areas, this->header.strategies.size());
+                if (this->header.flags & TRAJECTORY_INTERFACE) out << "(interface: " << interface(sample) << ")";
+                out << "]";
+                if (sample != samples() - 1) out << ", ";
+            }
+            out << "]";
+        }
+
+    private:
+        bool read_header() {
+            if (this->size < 12 || memcmp(this->data, trajectory_magic, 8) != 0) return false;
+            size_t header_size = get_u32(this->data + 8);
+            if (header_size > this->size || header_size < 72) return false;
+            const unsigned char * in = this->data + 12;
+            const unsigned char * end = this->data + header_size;
+            trajectory_header & h = this->header;
+            h.dimension = get_u32(in);
+            h.torus_size = get_u64(in + 4);
+            h.experiment_id = get_u64(in + 12);
+            h.sample_size = get_u64(in + 20);
+            h.flags = get_u32(in + 28);
+            size_t name_length = get_u32(in + 32);
+            in += 36;
+            if (in + name_length + 16 > end) return false;
+            h.scenario.assign((const char *) in, name_length);
+            in += name_length;
+            uint64_t mine_chance_bits = get_u64(in);
+            memcpy(&h.mine_chance, &mine_chance_bits, 8);
+            h.distance = (int) get_u32(in + 8);
+            unsigned int teams = get_u32(in + 12);
+            in += 16;
+            for (unsigned int team = 0; team < teams; team++) {
+                if (in + 8 > end) return false;
+                h.moves_per_step.push_back(get_u32(in));
+                unsigned int agents = get_u32(in + 4);
+                in += 8;
+                if (in + 4 * (size_t) agents > end) return false;
+                h.strategies.push_back(std::vector<unsigned int>());
+                for (unsigned int agent = 0; agent < agents; agent++) {
+                    h.strategies.back().push_back(get_u32(in));
+                    in += 4;
+                }
+            }
+            if (in + 8 > end) return false;
+            unsigned long long checkpoints = get_u64(in);
+            in += 8;
+            if (checkpoints != (size_t) (end - in) / 8 || (end - in) % 8 != 0) return false;
+            for (unsigned long long i = 0; i < checkpoints; i++) {
+                h.checkpoints.push_back(get_u64(in + 8 * i));
+            }
+            return true;
+        }
+};
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "trajectory.cpp"
+
+/*
+ * Reads the binary trajectory files simulations write with BINARY_OUTPUT.
+ *
+ * Build with g++ -O2 trajectory_reader.cpp -o trajectory_reader and run as
+ *   ./trajectory_reader FILE                      prints the header
+ *   ./trajectory_reader FILE text                 exports the samples in the text format
+ *   ./trajectory_reader FILE dump [first] [last]  prints samples first .. last - 1, one per line
+ *   ./trajectory_reader FILE checkpoint C [team]  prints the area of the team at checkpoint C of every sample
+ *   ./trajectory_reader FILE interface C          prints the interface at checkpoint C of every sample
+ */
+
+void print_header(trajectory_header & h) {
+    std::cout << "scenario: " << h.scenario << "\n";
+    std::cout << "dimension: " << h.dimension << "\n";
+    std::cout << "torus size: " << h.torus_size << "\n";
+    std::cout << "experiment id: " << h.experiment_id << "\n";
+    std::cout << "samples: " << h.sample_size << "\n";
+    if (h.mine_chance > 0) std::cout << "mine chance: " << h.mine_chance << "\n";
+    if (h.distance != -1) std::cout << "distance: " << h.distance << "\n";
+    for (size_t team = 0; team < h.strategies.size(); team++) {
+        std::cout << "team " << team + 1 << ": " << h.moves_per_step[team] << " moves per step, strategies";
+        for (unsigned int strategy : h.strategies[team]) {
+            std::cout << " " << strategy;
+        }
+        std::cout << "\n";
+    }
+    std::cout << "checkpoints: " << h.checkpoints.size();
+    if (!h.checkpoints.empty()) std::cout << ", steps " << h.checkpoints.front() << " .. " << h.checkpoints.back();
+    std::cout << "\n";
+    std::cout << "interface: " << ((h.flags & TRAJECTORY_INTERFACE) ? ((h.flags & TRAJECTORY_INTERFACE_SERIES) ? "at every checkpoint" : "at the end") : "no") << "\n";
+}
+
+void dump(trajectory_reader & reader, unsigned long long first, unsigned long long last) {
+    for (unsigned long long sample = first; sample < last && sample < reader.samples(); sample++) {
+        std::cout << sample;
+        for (unsigned long long area : reader.areas(sample)) {
+            std::cout << " " << area;
+        }
+        for (long long interface : reader.interfaces(sample)) {
+            std::cout << " " << interface;
+        }
+        if (reader.header.flags & TRAJECTORY_SITES) {
+            for (unsigned long long site : reader.sites(sample)) {
+                std::cout << " " << site;
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " FILE [text | dump [first] [last] | checkpoint C [team] | interface C]" << std::endl;
+        return 1;
+    }
+    trajectory_reader reader;
+    if (!reader.open(argv[1])) return 1;
+    const char * command = argc > 2 ? argv[2] : "header";
+    if (strcmp(command, "header") == 0) {
+        print_header(reader.header);
+    } else if (strcmp(command, "text") == 0) {
+        reader.export_text(std::cout);
+    } else if (strcmp(command, "dump") == 0) {
+        unsigned long long first = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+        unsigned long long last = argc > 4 ? strtoull(argv[4], NULL, 10) : reader.samples();
+        dump(reader, first, last);
+    } else if (strcmp(command, "checkpoint") == 0 && argc > 3) {
+        unsigned long long checkpoint = strtoull(argv[3], NULL, 10);
+        unsigned int team = argc > 4 ? atoi(argv[4]) : 0;
+        if (checkpoint >= reader.header.checkpoints.size() || team >= reader.header.strategies.size()) {
+            std::cerr << "the file has " << reader.header.checkpoints.size() << " checkpoints and " << reader.header.strategies.size() << " teams" << std::endl;
+            return 1;
+        }
+        for (unsigned long long sample = 0; sample < reader.samples(); sample++) {
+            std::cout << reader.area(sample, checkpoint, team) << "\n";
+        }
+    } else if (strcmp(command, "interface") == 0 && argc > 3) {
+        unsigned long long checkpoint = strtoull(argv[3], NULL, 10);
+        if (!(reader.header.flags & TRAJECTORY_INTERFACE_SERIES) || checkpoint >= reader.header.checkpoints.size()) {
+            std::cerr << "the file has no interface at checkpoint " << checkpoint << std::endl;
+            return 1;
+        }
+        for (unsigned long long sample = 0; sample < reader.samples(); sample++) {
+            std::cout << reader.interfaces(sample)[checkpoint] << "\n";
+        }
+    } else {
+        std::cerr << "unknown command " << command << std::endl;
+        return 1;
+    }
+    return 0;
+}